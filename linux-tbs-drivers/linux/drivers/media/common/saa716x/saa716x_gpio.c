@@ -1,9 +1,11 @@
 #include <linux/kernel.h>
 #include <linux/spinlock.h>
+#include <linux/interrupt.h>
 
 #include "saa716x_mod.h"
 
 #include "saa716x_gpio_reg.h"
+#include "saa716x_msi_reg.h"
 
 #include "saa716x_gpio.h"
 #include "saa716x_spi.h"
@@ -138,3 +140,60 @@ int saa716x_gpio_read(struct saa716x_dev *saa716x, int gpio)
 	return 0;
 }
 EXPORT_SYMBOL_GPL(saa716x_gpio_read);
+
+/*
+ * GPIO 0..15 can raise an MSI vector (EXTINT_n) on either edge.
+ * The handler runs in hard interrupt context from saa716x_msi_event().
+ */
+int saa716x_gpio_irq_request(struct saa716x_dev *saa716x, int gpio,
+			     void (*handler)(void *priv), void *priv)
+{
+	u32 data;
+
+	if (gpio < 0 || gpio > 15 || handler == NULL)
+		return -EINVAL;
+	if (saa716x->gpio_irq_handler[gpio])
+		return -EBUSY;
+
+	saa716x_gpio_set_input(saa716x, gpio);
+
+	data = SAA716x_EPRD(MSI, MSI_CONFIG33 + 4 * gpio);
+	data |= MSI_INT_POL_EDGE_ANY;
+	SAA716x_EPWR(MSI, MSI_CONFIG33 + 4 * gpio, data);
+
+	saa716x->gpio_irq_priv[gpio] = priv;
+	smp_wmb();
+	saa716x->gpio_irq_handler[gpio] = handler;
+
+	SAA716x_EPWR(MSI, MSI_INT_STATUS_CLR_H, MSI_INT_EXTINT_0 << gpio);
+	SAA716x_EPWR(MSI, MSI_INT_ENA_SET_H, MSI_INT_EXTINT_0 << gpio);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(saa716x_gpio_irq_request);
+
+void saa716x_gpio_irq_free(struct saa716x_dev *saa716x, int gpio)
+{
+	if (gpio < 0 || gpio > 15 || !saa716x->gpio_irq_handler[gpio])
+		return;
+
+	SAA716x_EPWR(MSI, MSI_INT_ENA_CLR_H, MSI_INT_EXTINT_0 << gpio);
+	synchronize_irq(saa716x->pdev->irq);
+	saa716x->gpio_irq_handler[gpio] = NULL;
+	saa716x->gpio_irq_priv[gpio] = NULL;
+}
+EXPORT_SYMBOL_GPL(saa716x_gpio_irq_free);
+
+void saa716x_gpio_irq_event(struct saa716x_dev *saa716x, u32 stat_h)
+{
+	void (*handler)(void *priv);
+	int gpio;
+
+	for (gpio = 0; gpio < 16; gpio++) {
+		if (!(stat_h & (MSI_INT_EXTINT_0 << gpio)))
+			continue;
+		handler = saa716x->gpio_irq_handler[gpio];
+		if (handler)
+			handler(saa716x->gpio_irq_priv[gpio]);
+	}
+}
@@ -23,4 +23,9 @@ extern void saa716x_gpio_set_mode(struct saa716x_dev *saa716x, int gpio, int mod
 extern void saa716x_gpio_write(struct saa716x_dev *saa716x, int gpio, int set);
 extern int saa716x_gpio_read(struct saa716x_dev *saa716x, int gpio);
 
+extern int saa716x_gpio_irq_request(struct saa716x_dev *saa716x, int gpio,
+				    void (*handler)(void *priv), void *priv);
+extern void saa716x_gpio_irq_free(struct saa716x_dev *saa716x, int gpio);
+extern void saa716x_gpio_irq_event(struct saa716x_dev *saa716x, u32 stat_h);
+
 #endif /* __SAA716x_GPIO_H */
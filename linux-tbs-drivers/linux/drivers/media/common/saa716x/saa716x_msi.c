@@ -8,6 +8,7 @@
 
 #include "saa716x_msi_reg.h"
 #include "saa716x_msi.h"
+#include "saa716x_gpio.h"
 #include "saa716x_spi.h"
 
 #include "saa716x_priv.h"
@@ -273,6 +274,9 @@ int saa716x_msi_event(struct saa716x_dev *saa716x, u32 stat_l, u32 stat_h)
 	if (stat_h & MSI_INT_EXTINT_15)
 		dprintk(SAA716x_DEBUG, 0, "<%s> ", vector_name[48]);
 
+	if (stat_h & (MSI_INT_EXTINT_ALL))
+		saa716x_gpio_irq_event(saa716x, stat_h);
+
 	if (stat_h & MSI_INT_I2CINT_0) {
 		dprintk(SAA716x_DEBUG, 0, "<%s> ", vector_name[49]);
 		saa716x_i2c_irqevent(saa716x, 0);
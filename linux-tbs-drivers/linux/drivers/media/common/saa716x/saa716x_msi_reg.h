@@ -120,6 +120,7 @@
 #define MSI_INT_EXTINT_13		(0x00000001 << 14)
 #define MSI_INT_EXTINT_14		(0x00000001 << 15)
 #define MSI_INT_EXTINT_15		(0x00000001 << 16)
+#define MSI_INT_EXTINT_ALL		(0x0000ffff <<  1)
 #define MSI_INT_I2CINT_0		(0x00000001 << 17)
 #define MSI_INT_I2CINT_1		(0x00000001 << 18)
 
@@ -160,6 +160,11 @@ struct saa716x_dev {
 	struct saa716x_cgu		cgu;
 
 	spinlock_t			gpio_lock;
+
+	/* GPIO edge interrupts (EXTINT_0..15), see saa716x_gpio_irq_request() */
+	void				(*gpio_irq_handler[16])(void *priv);
+	void				*gpio_irq_priv[16];
+
 	/* DMA */
 
 	struct saa716x_fgpi_stream_port	fgpi[4];
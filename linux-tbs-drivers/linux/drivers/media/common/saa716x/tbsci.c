@@ -9,6 +9,9 @@
 
 #define TBSCI_I2C_ADDR 0x1a
 
+/* number of CAM data bytes moved per i2c_transfer() */
+#define TBSCI_BURST 16
+
 struct tbsci_state {
 	struct dvb_ca_en50221 ca;
 	struct mutex ca_mutex;
@@ -16,23 +19,35 @@ struct tbsci_state {
 	int nr, mode;
 	void *priv; /* struct saa716x_adapter *priv; */
 	int status;
+	int cd_gpio[2]; /* card detect inputs */
+	int cd_irqs; /* no. of cd_gpio with an edge interrupt */
+	int cd_ready; /* ca initialized, cd interrupts may poll it */
+	int ts_enabled; /* CAM ready for TS */
+	int bypass; /* TS routed around the CAM on request */
 };
 
-int tbsci_i2c_read(struct tbsci_state *state)
+static u16 tbsci_i2c_addr(struct tbsci_state *state)
 {
-	int ret;
-	u8 buf = 0;
-
-	struct i2c_msg msg = { .addr = TBSCI_I2C_ADDR, .flags = I2C_M_RD,
-			.buf = &buf, .len = 1 };
+	u16 addr = TBSCI_I2C_ADDR;
 
 	if (((state->mode == 2) || (state->mode == 4) ||
 			(state->mode == 6) || (state->mode == 8) || (state->mode == 9))
 		&& (state->nr == 1))
-		msg.addr += 1;
+		addr += 1;
 
 	if (state->mode == 10)
-		msg.addr += 2;
+		addr += 2;
+
+	return addr;
+}
+
+int tbsci_i2c_read(struct tbsci_state *state)
+{
+	int ret;
+	u8 buf = 0;
+
+	struct i2c_msg msg = { .addr = tbsci_i2c_addr(state), .flags = I2C_M_RD,
+			.buf = &buf, .len = 1 };
 
 	ret = i2c_transfer(state->i2c_adap, &msg, 1);
 
@@ -50,17 +65,9 @@ int tbsci_i2c_write(struct tbsci_state *state,
 	int ret;
 	unsigned char buf[len + 1];
 
-	struct i2c_msg msg = { .addr = TBSCI_I2C_ADDR, .flags = 0,
+	struct i2c_msg msg = { .addr = tbsci_i2c_addr(state), .flags = 0,
 			.buf = &buf[0], .len = len + 1 };
 
-	if (((state->mode == 2) || (state->mode == 4) ||
-			(state->mode == 6) || (state->mode == 8) || (state->mode == 9)) 
-		&& (state->nr == 1))
-		msg.addr += 1;
-
-	if (state->mode == 10)
-		msg.addr += 2;
-
 	memcpy(&buf[1], data, len);
 	buf[0] = addr;
 
@@ -122,6 +129,103 @@ int tbsci_write_cam_control(struct dvb_ca_en50221 *ca, int slot,
 	return 0;
 }
 
+/*
+ * The CI controller performs one CAM access per register select, so a
+ * burst keeps the select/read (or select+write) pair per byte but sends
+ * TBSCI_BURST of them in a single i2c_transfer() under one ca_mutex
+ * hold, with repeated starts instead of a full transaction per byte.
+ * saa716x_i2c_xfer() replays a failed transfer from its first message,
+ * so after a burst error the rest of the block goes one byte per
+ * transfer, as before bursts were used.
+ */
+int tbsci_read_cam_data(struct dvb_ca_en50221 *ca, int slot,
+	u8 *buf, int count)
+{
+	struct tbsci_state *state = ca->data;
+	struct i2c_msg msg[2 * TBSCI_BURST];
+	u8 sel[2] = { 0x80, 0 /* CTRLIF_DATA */ };
+	u16 addr = tbsci_i2c_addr(state);
+	int burst = TBSCI_BURST, done = 0, i, n, ret = 0;
+
+	if (slot != 0)
+		return -EINVAL;
+
+	mutex_lock(&state->ca_mutex);
+
+	while (done < count) {
+		n = min(count - done, burst);
+		for (i = 0; i < n; i++) {
+			msg[2 * i].addr = addr;
+			msg[2 * i].flags = 0;
+			msg[2 * i].buf = sel;
+			msg[2 * i].len = 2;
+			msg[2 * i + 1].addr = addr;
+			msg[2 * i + 1].flags = I2C_M_RD;
+			msg[2 * i + 1].buf = &buf[done + i];
+			msg[2 * i + 1].len = 1;
+		}
+		ret = i2c_transfer(state->i2c_adap, msg, 2 * n);
+		if (ret != 2 * n) {
+			printk("tbsci: burst read error=%d\n", ret);
+			ret = -EREMOTEIO;
+			if (burst == 1)
+				break;
+			burst = 1;
+			continue;
+		}
+		ret = 0;
+		done += n;
+	}
+
+	mutex_unlock(&state->ca_mutex);
+
+	return ret < 0 ? ret : done;
+}
+
+int tbsci_write_cam_data(struct dvb_ca_en50221 *ca, int slot,
+	const u8 *buf, int count)
+{
+	struct tbsci_state *state = ca->data;
+	struct i2c_msg msg[TBSCI_BURST];
+	u8 data[TBSCI_BURST][3];
+	u16 addr = tbsci_i2c_addr(state);
+	int burst = TBSCI_BURST, done = 0, i, n, ret = 0;
+
+	if (slot != 0)
+		return -EINVAL;
+
+	mutex_lock(&state->ca_mutex);
+
+	while (done < count) {
+		n = min(count - done, burst);
+		for (i = 0; i < n; i++) {
+			data[i][0] = 0x80;
+			data[i][1] = 0; /* CTRLIF_DATA */
+			data[i][2] = buf[done + i];
+			msg[i].addr = addr;
+			msg[i].flags = 0;
+			msg[i].buf = data[i];
+			msg[i].len = 3;
+		}
+
+		ret = i2c_transfer(state->i2c_adap, msg, n);
+		if (ret != n) {
+			printk("tbsci: burst write error=%d\n", ret);
+			ret = -EREMOTEIO;
+			if (burst == 1)
+				break;
+			burst = 1;
+			continue;
+		}
+		ret = 0;
+		done += n;
+	}
+
+	mutex_unlock(&state->ca_mutex);
+
+	return ret < 0 ? ret : done;
+}
+
 int tbsci_read_attribute_mem(struct dvb_ca_en50221 *ca,
 	int slot, int address)
 {
@@ -226,12 +330,51 @@ static int tbsci_set_video_port(struct dvb_ca_en50221 *ca,
 
 int tbsci_slot_shutdown(struct dvb_ca_en50221 *ca, int slot)
 {
+	struct tbsci_state *state = ca->data;
+
+	state->ts_enabled = 0;
 	return tbsci_set_video_port(ca, slot, /* enable */ 0);
 }
 
 int tbsci_slot_ts_enable(struct dvb_ca_en50221 *ca, int slot)
 {
-	return tbsci_set_video_port(ca, slot, /* enable */ 1);
+	struct tbsci_state *state = ca->data;
+
+	state->ts_enabled = 1;
+	return tbsci_set_video_port(ca, slot, /* enable */ !state->bypass);
+}
+
+/*
+ * The CI sits in the TS path between the adapter's own demodulator and
+ * its FGPI port, so the TS can only go through or around the CAM.
+ */
+int tbsci_get_ts_bypass(struct dvb_ca_en50221 *ca, int slot, int *bypass)
+{
+	struct tbsci_state *state = ca->data;
+
+	if (slot != 0)
+		return -EINVAL;
+
+	*bypass = state->bypass;
+	return 0;
+}
+
+int tbsci_set_ts_bypass(struct dvb_ca_en50221 *ca, int slot, int bypass)
+{
+	struct tbsci_state *state = ca->data;
+
+	if (slot != 0)
+		return -EINVAL;
+	/* tbsci_set_video_port() only knows how to route modes 0..9 */
+	if (state->mode < 0 || state->mode > 9)
+		return -EOPNOTSUPP;
+
+	if (state->bypass == bypass)
+		return 0;
+	state->bypass = bypass;
+	if (!state->ts_enabled)
+		return 0;
+	return tbsci_set_video_port(ca, slot, /* enable */ !bypass);
 }
 
 int tbsci_slot_reset(struct dvb_ca_en50221 *ca, int slot)
@@ -360,10 +503,87 @@ int tbsci_poll_slot_status(struct dvb_ca_en50221 *ca,
 	}
 }
 
+/* card detect lines of the modes that sense CD1#/CD2# on bridge GPIOs */
+static int tbsci_cd_gpios(struct tbsci_state *state)
+{
+	switch (state->mode) {
+	case 3:
+	case 7:
+		state->cd_gpio[0] = 3;
+		state->cd_gpio[1] = 5;
+		break;
+	case 4:
+		state->cd_gpio[0] = state->nr ? 3 : 14;
+		state->cd_gpio[1] = state->nr ? 6 : 2;
+		break;
+	case 5:
+		state->cd_gpio[0] = 6;
+		state->cd_gpio[1] = 14;
+		break;
+	case 6:
+		state->cd_gpio[0] = state->nr ? 17 : 5;
+		state->cd_gpio[1] = state->nr ? 16 : 6;
+		break;
+	case 8:
+	case 9:
+		state->cd_gpio[0] = state->nr ? 6 : 2;
+		state->cd_gpio[1] = state->nr ? 3 : 14;
+		break;
+	default:
+		return 0;
+	}
+	/* only GPIO 0..15 can raise an interrupt */
+	if (state->cd_gpio[0] > 15 || state->cd_gpio[1] > 15)
+		return 0;
+	return 2;
+}
+
+static void tbsci_cd_irq(void *priv)
+{
+	struct tbsci_state *state = priv;
+
+	if (!state->cd_ready)
+		return;
+	smp_rmb();
+	dvb_ca_en50221_poll_irq(&state->ca, 0);
+}
+
+static void tbsci_cd_irq_free(struct tbsci_state *state)
+{
+	struct saa716x_adapter *adap = state->priv;
+
+	while (state->cd_irqs)
+		saa716x_gpio_irq_free(adap->saa716x,
+				      state->cd_gpio[--state->cd_irqs]);
+}
+
+/*
+ * Get an interrupt on both card detect edges, so that the CA thread
+ * only has to poll the slot status when it actually changed.
+ */
+static int tbsci_cd_irq_request(struct tbsci_state *state)
+{
+	struct saa716x_adapter *adap = state->priv;
+	int i, n;
+
+	n = tbsci_cd_gpios(state);
+	for (i = 0; i < n; i++) {
+		if (saa716x_gpio_irq_request(adap->saa716x, state->cd_gpio[i],
+					     tbsci_cd_irq, state))
+			break;
+		state->cd_irqs++;
+	}
+	if (n == 0 || state->cd_irqs < n) {
+		tbsci_cd_irq_free(state);
+		return 0;
+	}
+	return 1;
+}
+
 int tbsci_init(struct saa716x_adapter *adap, int tbsci_nr, int tbsci_mode)
 {
 	struct tbsci_state *state;
-	int ret;
+	int ret, flags = 0;
 	unsigned char data;
 
 	/* allocate memory for the internal state */
@@ -387,10 +607,14 @@ int tbsci_init(struct saa716x_adapter *adap, int tbsci_nr, int tbsci_mode)
 	state->ca.write_attribute_mem = tbsci_write_attribute_mem;
 	state->ca.read_cam_control = tbsci_read_cam_control;
 	state->ca.write_cam_control = tbsci_write_cam_control;
+	state->ca.read_cam_data = tbsci_read_cam_data;
+	state->ca.write_cam_data = tbsci_write_cam_data;
 	state->ca.slot_reset = tbsci_slot_reset;
 	state->ca.slot_shutdown = tbsci_slot_shutdown;
 	state->ca.slot_ts_enable = tbsci_slot_ts_enable;
 	state->ca.poll_slot_status = tbsci_poll_slot_status;
+	state->ca.get_ts_bypass = tbsci_get_ts_bypass;
+	state->ca.set_ts_bypass = tbsci_set_ts_bypass;
 	state->ca.data = state;
 	state->priv = adap;
 
@@ -510,11 +734,22 @@ int tbsci_init(struct saa716x_adapter *adap, int tbsci_nr, int tbsci_mode)
 		return 0;
 	}
 
+	if (tbsci_cd_irq_request(state))
+		flags = DVB_CA_EN50221_FLAG_IRQ_POLL;
+
 	ret = dvb_ca_en50221_init(&adap->dvb_adapter, &state->ca,
-		/* flags */ 0, /* n_slots */ 1);
-	if (ret != 0) goto error2;
+		flags, /* n_slots */ 1);
+	if (ret != 0) {
+		tbsci_cd_irq_free(state);
+		goto error2;
+	}
+
+	/* only once the CA thread runs, a card detect edge wakes it up */
+	smp_wmb();
+	state->cd_ready = 1;
 
-	printk("tbsci: Adapter %d CI slot initialized\n", adap->dvb_adapter.num);
+	printk("tbsci: Adapter %d CI slot initialized%s\n", adap->dvb_adapter.num,
+		flags ? " (card detect IRQ)" : "");
 
 	return 0;
 	
@@ -537,6 +772,7 @@ void tbsci_release(struct saa716x_adapter *adap)
 
 	if (NULL == state->ca.data) return;
 
+	tbsci_cd_irq_free(state);
 	dvb_ca_en50221_release(&state->ca);
 	//memset(&state->ca, 0, sizeof(state->ca));
 	kfree(state);
@@ -14,6 +14,10 @@
 
 #include "dvb_ca_en50221.h"
 
+extern int tbsci_read_cam_data(struct dvb_ca_en50221 *en50221,
+	int slot, u8 *buf, int count);
+extern int tbsci_write_cam_data(struct dvb_ca_en50221 *en50221,
+	int slot, const u8 *buf, int count);
 extern int tbsci_read_attribute_mem(struct dvb_ca_en50221 *en50221, 
 	int slot, int addr);
 extern int tbsci_write_attribute_mem(struct dvb_ca_en50221 *en50221, 
@@ -30,6 +34,10 @@ extern int tbsci_slot_ts_enable(struct dvb_ca_en50221 *en50221,
 	int slot);
 extern int tbsci_poll_slot_status(struct dvb_ca_en50221 *en50221, 
 	int slot, int open);
+extern int tbsci_get_ts_bypass(struct dvb_ca_en50221 *en50221,
+	int slot, int *bypass);
+extern int tbsci_set_ts_bypass(struct dvb_ca_en50221 *en50221,
+	int slot, int bypass);
 extern int tbsci_init(struct saa716x_adapter *adap, int tbsci_nr,
 	int tbsci_mode);
 extern void tbsci_release(struct saa716x_adapter *adap);
@@ -72,6 +72,64 @@ int tbs_ci_write_cam_control(struct dvb_ca_en50221 *ca, int slot,
 	return 0;
 }
 
+/*
+ * Each CAM access is one command to the CI core followed by a settle
+ * time. The block variants take ca_mutex once for the whole buffer and
+ * wait with usleep_range() rather than msleep(1), which rounds up to
+ * two jiffies per byte (20 ms at HZ=100).
+ */
+int tbs_ci_read_cam_data(struct dvb_ca_en50221 *ca, int slot,
+	u8 *buf, int count)
+{
+	struct tbs_ci_state *state = ca->data;
+	struct tbs_adapter *adapter =
+			(struct tbs_adapter *) state->priv;
+	struct tbs_pcie_dev *dev = adapter->dev;
+	int i;
+
+	if (slot != 0)
+		return -EINVAL;
+
+	mutex_lock(&state->ca_mutex);
+
+	for (i = 0; i < count; i++) {
+		/* CTRLIF_DATA, read */
+		TBS_PCIE_WRITE(TBS_CI_BASE(state->nr), 0x00, 0x02 << 16);
+		usleep_range(1000, 1100);
+		buf[i] = TBS_PCIE_READ(TBS_CI_BASE(state->nr), 0x08) & 0xff;
+	}
+
+	mutex_unlock(&state->ca_mutex);
+
+	return count;
+}
+
+int tbs_ci_write_cam_data(struct dvb_ca_en50221 *ca, int slot,
+	const u8 *buf, int count)
+{
+	struct tbs_ci_state *state = ca->data;
+	struct tbs_adapter *adapter =
+			(struct tbs_adapter *) state->priv;
+	struct tbs_pcie_dev *dev = adapter->dev;
+	int i;
+
+	if (slot != 0)
+		return -EINVAL;
+
+	mutex_lock(&state->ca_mutex);
+
+	for (i = 0; i < count; i++) {
+		/* CTRLIF_DATA, write */
+		TBS_PCIE_WRITE(TBS_CI_BASE(state->nr), 0x00,
+			(0x03 << 16) | (buf[i] << 24));
+		usleep_range(1000, 1100);
+	}
+
+	mutex_unlock(&state->ca_mutex);
+
+	return count;
+}
+
 int tbs_ci_read_attribute_mem(struct dvb_ca_en50221 *ca,
 	int slot, int address)
 {
@@ -246,6 +304,8 @@ int tbs_ci_init(struct tbs_adapter *adap, int nr)
 	state->ca.write_attribute_mem = tbs_ci_write_attribute_mem;
 	state->ca.read_cam_control = tbs_ci_read_cam_control;
 	state->ca.write_cam_control = tbs_ci_write_cam_control;
+	state->ca.read_cam_data = tbs_ci_read_cam_data;
+	state->ca.write_cam_data = tbs_ci_write_cam_data;
 	state->ca.slot_reset = tbs_ci_slot_reset;
 	state->ca.slot_shutdown = tbs_ci_slot_shutdown;
 	state->ca.slot_ts_enable = tbs_ci_slot_ts_enable;
@@ -82,6 +82,9 @@ enum dmx_success {
 #define TS_DECODER      4   /* send stream to built-in decoder (if present) */
 #define TS_DEMUX        8   /* in case TS_PACKET is set, send the TS to
 			       the demux device, not to the dvr device */
+#define TS_PES         16   /* in case TS_PACKET is set, send whole PES
+			       packets, buffer1 holds a struct dmx_pes_info
+			       and buffer2 the packet */
 
 /* PES type for filters which write to built-in decoder */
 /* these should be kept identical to the types in dmx.h */
@@ -573,6 +573,7 @@ static int dvb_dmxdev_start_feed(struct dmxdev *dmxdev,
 	int ts_type;
 	dmx_pes_type_t ts_pes;
 	struct dmx_ts_feed *tsfeed;
+	size_t size = 32768;
 
 	feed->ts = NULL;
 	otype = para->output;
@@ -591,6 +592,15 @@ static int dvb_dmxdev_start_feed(struct dmxdev *dmxdev,
 	else if (otype == DMX_OUT_TAP)
 		ts_type |= TS_PACKET | TS_DEMUX | TS_PAYLOAD_ONLY;
 
+	if (para->flags & DMX_PES_ASSEMBLE) {
+		if (feed->pid > 0x1fff ||
+		    filter->buffer.size <= sizeof(struct dmx_pes_info) + 188)
+			return -EINVAL;
+		ts_type |= TS_PES;
+		/* a whole record has to fit, the ring buffer keeps a byte free */
+		size = filter->buffer.size - 1 - sizeof(struct dmx_pes_info);
+	}
+
 	ret = dmxdev->demux->allocate_ts_feed(dmxdev->demux, &feed->ts,
 					      dvb_dmxdev_ts_callback);
 	if (ret < 0)
@@ -599,7 +609,7 @@ static int dvb_dmxdev_start_feed(struct dmxdev *dmxdev,
 	tsfeed = feed->ts;
 	tsfeed->priv = filter;
 
-	ret = tsfeed->set(tsfeed, feed->pid, ts_type, ts_pes, 32768, timeout);
+	ret = tsfeed->set(tsfeed, feed->pid, ts_type, ts_pes, size, timeout);
 	if (ret < 0) {
 		dmxdev->demux->release_ts_feed(dmxdev->demux, tsfeed);
 		return ret;
@@ -882,6 +892,10 @@ static int dvb_dmxdev_pes_filter_set(struct dmxdev *dmxdev,
 	if (params->pes_type > DMX_PES_OTHER || params->pes_type < 0)
 		return -EINVAL;
 
+	if ((params->flags & DMX_PES_ASSEMBLE) &&
+	    params->output != DMX_OUT_TAP)
+		return -EINVAL;
+
 	dmxdevfilter->type = DMXDEV_TYPE_PES;
 	memcpy(&dmxdevfilter->params, params,
 	       sizeof(struct dmx_pes_filter_params));
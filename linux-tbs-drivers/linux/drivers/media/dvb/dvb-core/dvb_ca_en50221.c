@@ -37,6 +37,8 @@
 #include <linux/spinlock.h>
 #include <linux/sched.h>
 #include <linux/kthread.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include "dvb_ca_en50221.h"
 #include "dvb_ringbuffer.h"
@@ -56,6 +58,10 @@ MODULE_PARM_DESC(cam_debug, "enable verbose debug messages");
 
 #define MAX_RX_PACKETS_PER_ITERATION 10
 
+/* without DA IRQs, double the data poll interval every this many empty polls */
+#define DA_POLL_BACKOFF 10
+#define DA_POLL_MAX_SHIFT 3
+
 #define CTRLIF_DATA      0
 #define CTRLIF_COMMAND   1
 #define CTRLIF_STATUS    1
@@ -119,6 +125,15 @@ struct dvb_ca_slot {
 
 	/* timer used during various states of the slot */
 	unsigned long timeout;
+
+	/* consecutive STATUS polls that found no data */
+	unsigned int idle_polls;
+
+	/* statistics, see dvb_ca_en50221_debugfs_show() */
+	unsigned long status_polls;	/* STATUS reads looking for data */
+	unsigned long data_reads;	/* of those, packets actually read */
+	unsigned long slot_polls;	/* poll_slot_status() calls */
+	unsigned long irqs;		/* IRQ notifications from the driver */
 };
 
 /* Private CA-interface information */
@@ -156,6 +171,9 @@ struct dvb_ca_private {
 
 	/* Slot to start looking for data to read from in the next user-space read operation */
 	int next_read_slot;
+
+	/* debugfs statistics file */
+	struct dentry *debugfs;
 };
 
 static void dvb_ca_en50221_thread_wakeup(struct dvb_ca_private *ca);
@@ -208,6 +226,7 @@ static int dvb_ca_en50221_check_camstatus(struct dvb_ca_private *ca, int slot)
 	}
 
 	/* poll mode */
+	ca->slot_info[slot].slot_polls++;
 	slot_status = ca->pub->poll_slot_status(ca->pub, slot, ca->open);
 
 	cam_present_now = (slot_status & DVB_CA_EN50221_POLL_CAM_PRESENT) ? 1 : 0;
@@ -609,13 +628,16 @@ static int dvb_ca_en50221_read_data(struct dvb_ca_private *ca, int slot, u8 * eb
 	}
 
 	/* check if there is data available */
+	ca->slot_info[slot].status_polls++;
 	if ((status = ca->pub->read_cam_control(ca->pub, slot, CTRLIF_STATUS)) < 0)
 		goto exit;
 	if (!(status & STATUSREG_DA)) {
 		/* no data */
+		ca->slot_info[slot].idle_polls++;
 		status = 0;
 		goto exit;
 	}
+	ca->slot_info[slot].idle_polls = 0;
 
 	/* read the amount of data */
 	if ((status = ca->pub->read_cam_control(ca->pub, slot, CTRLIF_SIZE_HIGH)) < 0)
@@ -651,13 +673,22 @@ static int dvb_ca_en50221_read_data(struct dvb_ca_private *ca, int slot, u8 * eb
 	}
 
 	/* fill the buffer */
-	for (i = 0; i < bytes_read; i++) {
-		/* read byte and check */
-		if ((status = ca->pub->read_cam_control(ca->pub, slot, CTRLIF_DATA)) < 0)
+	if (ca->pub->read_cam_data) {
+		if ((status = ca->pub->read_cam_data(ca->pub, slot, buf, bytes_read)) < 0)
 			goto exit;
+		if (status != bytes_read) {
+			status = -EIO;
+			goto exit;
+		}
+	} else {
+		for (i = 0; i < bytes_read; i++) {
+			/* read byte and check */
+			if ((status = ca->pub->read_cam_control(ca->pub, slot, CTRLIF_DATA)) < 0)
+				goto exit;
 
-		/* OK, store it in the buffer */
-		buf[i] = status;
+			/* OK, store it in the buffer */
+			buf[i] = status;
+		}
 	}
 
 	/* check for read error (RE should now be 0) */
@@ -680,6 +711,7 @@ static int dvb_ca_en50221_read_data(struct dvb_ca_private *ca, int slot, u8 * eb
 		memcpy(ebuf, buf, bytes_read);
 	}
 
+	ca->slot_info[slot].data_reads++;
 	dprintk("Received CA packet for slot %i connection id 0x%x last_frag:%i size:0x%x\n", slot,
 		buf[0], (buf[1] & 0x80) == 0, bytes_read);
 
@@ -754,9 +786,18 @@ static int dvb_ca_en50221_write_data(struct dvb_ca_private *ca, int slot, u8 * b
 		goto exit;
 
 	/* send the buffer */
-	for (i = 0; i < bytes_write; i++) {
-		if ((status = ca->pub->write_cam_control(ca->pub, slot, CTRLIF_DATA, buf[i])) != 0)
+	if (ca->pub->write_cam_data) {
+		if ((status = ca->pub->write_cam_data(ca->pub, slot, buf, bytes_write)) < 0)
+			goto exit;
+		if (status != bytes_write) {
+			status = -EIO;
 			goto exit;
+		}
+	} else {
+		for (i = 0; i < bytes_write; i++) {
+			if ((status = ca->pub->write_cam_control(ca->pub, slot, CTRLIF_DATA, buf[i])) != 0)
+				goto exit;
+		}
 	}
 
 	/* check for write error (WE should now be 0) */
@@ -823,6 +864,7 @@ void dvb_ca_en50221_camchange_irq(struct dvb_ca_en50221 *pubca, int slot, int ch
 	struct dvb_ca_private *ca = pubca->private;
 
 	dprintk("CAMCHANGE IRQ slot:%i change_type:%i\n", slot, change_type);
+	ca->slot_info[slot].irqs++;
 
 	switch (change_type) {
 	case DVB_CA_EN50221_CAMCHANGE_REMOVED:
@@ -851,6 +893,7 @@ void dvb_ca_en50221_camready_irq(struct dvb_ca_en50221 *pubca, int slot)
 	struct dvb_ca_private *ca = pubca->private;
 
 	dprintk("CAMREADY IRQ slot:%i\n", slot);
+	ca->slot_info[slot].irqs++;
 
 	if (ca->slot_info[slot].slot_state == DVB_CA_SLOTSTATE_WAITREADY) {
 		ca->slot_info[slot].slot_state = DVB_CA_SLOTSTATE_VALIDATE;
@@ -871,6 +914,7 @@ void dvb_ca_en50221_frda_irq(struct dvb_ca_en50221 *pubca, int slot)
 	int flags;
 
 	dprintk("FR/DA IRQ slot:%i\n", slot);
+	ca->slot_info[slot].irqs++;
 
 	switch (ca->slot_info[slot].slot_state) {
 	case DVB_CA_SLOTSTATE_LINKINIT:
@@ -889,6 +933,26 @@ void dvb_ca_en50221_frda_irq(struct dvb_ca_en50221 *pubca, int slot)
 }
 
 
+/**
+ * The slot status may have changed, poll it now.
+ *
+ * @param ca CA instance.
+ * @param slot Slot concerned.
+ */
+void dvb_ca_en50221_poll_irq(struct dvb_ca_en50221 *pubca, int slot)
+{
+	struct dvb_ca_private *ca = pubca->private;
+
+	if (ca == NULL)
+		return;
+
+	dprintk("POLL IRQ slot:%i\n", slot);
+	ca->slot_info[slot].irqs++;
+	dvb_ca_en50221_thread_wakeup(ca);
+}
+EXPORT_SYMBOL(dvb_ca_en50221_poll_irq);
+
+
 
 /* ******************************************************************************** */
 /* EN50221 thread functions */
@@ -918,6 +982,9 @@ static void dvb_ca_en50221_thread_update_delay(struct dvb_ca_private *ca)
 	int delay;
 	int curdelay = 100000000;
 	int slot;
+	int camchange_irq = ca->flags & (DVB_CA_EN50221_FLAG_IRQ_CAMCHANGE |
+					 DVB_CA_EN50221_FLAG_IRQ_POLL);
+	unsigned int shift;
 
 	/* Beware of too high polling frequency, because one polling
 	 * call might take several hundred milliseconds until timeout!
@@ -927,12 +994,12 @@ static void dvb_ca_en50221_thread_update_delay(struct dvb_ca_private *ca)
 		default:
 		case DVB_CA_SLOTSTATE_NONE:
 			delay = HZ * 60;  /* 60s */
-			if (!(ca->flags & DVB_CA_EN50221_FLAG_IRQ_CAMCHANGE))
+			if (!camchange_irq)
 				delay = HZ * 5;  /* 5s */
 			break;
 		case DVB_CA_SLOTSTATE_INVALID:
 			delay = HZ * 60;  /* 60s */
-			if (!(ca->flags & DVB_CA_EN50221_FLAG_IRQ_CAMCHANGE))
+			if (!camchange_irq)
 				delay = HZ / 10;  /* 100ms */
 			break;
 
@@ -946,12 +1013,20 @@ static void dvb_ca_en50221_thread_update_delay(struct dvb_ca_private *ca)
 
 		case DVB_CA_SLOTSTATE_RUNNING:
 			delay = HZ * 60;  /* 60s */
-			if (!(ca->flags & DVB_CA_EN50221_FLAG_IRQ_CAMCHANGE))
+			if (!camchange_irq)
 				delay = HZ / 10;  /* 100ms */
 			if (ca->open) {
 				if ((!ca->slot_info[slot].da_irq_supported) ||
-				    (!(ca->flags & DVB_CA_EN50221_FLAG_IRQ_DA)))
-					delay = HZ / 10;  /* 100ms */
+				    (!(ca->flags & DVB_CA_EN50221_FLAG_IRQ_DA))) {
+					/*
+					 * Poll for data every 100ms, backing off
+					 * up to 800ms while the CAM stays idle.
+					 * A write from user space resets this.
+					 */
+					shift = min_t(unsigned int, DA_POLL_MAX_SHIFT,
+						      ca->slot_info[slot].idle_polls / DA_POLL_BACKOFF);
+					delay = (HZ / 10) << shift;
+				}
 			}
 			break;
 		}
@@ -985,6 +1060,7 @@ static int dvb_ca_en50221_thread(void *data)
 	/* main loop */
 	while (!kthread_should_stop()) {
 		/* sleep for a bit */
+		dvb_ca_en50221_thread_update_delay(ca);
 		if (!ca->wakeup) {
 			set_current_state(TASK_INTERRUPTIBLE);
 			schedule_timeout(ca->delay);
@@ -1236,6 +1312,39 @@ static int dvb_ca_en50221_io_do_ioctl(struct file *file,
 		break;
 	}
 
+	case CA_GET_TS_BYPASS: {
+		struct ca_ts_bypass *tsb = parg;
+
+		if (tsb->slot >= ca->slot_count)
+			return -EINVAL;
+
+		tsb->bypass = 0;
+		if (ca->pub->get_ts_bypass) {
+			mutex_lock(&ca->slot_info[tsb->slot].slot_lock);
+			err = ca->pub->get_ts_bypass(ca->pub, tsb->slot,
+						     &tsb->bypass);
+			mutex_unlock(&ca->slot_info[tsb->slot].slot_lock);
+		}
+		break;
+	}
+
+	case CA_SET_TS_BYPASS: {
+		struct ca_ts_bypass *tsb = parg;
+
+		if (tsb->slot >= ca->slot_count)
+			return -EINVAL;
+
+		if (!ca->pub->set_ts_bypass) {
+			if (tsb->bypass)
+				return -EOPNOTSUPP;
+			break;
+		}
+		mutex_lock(&ca->slot_info[tsb->slot].slot_lock);
+		err = ca->pub->set_ts_bypass(ca->pub, tsb->slot, !!tsb->bypass);
+		mutex_unlock(&ca->slot_info[tsb->slot].slot_lock);
+		break;
+	}
+
 	default:
 		err = -EINVAL;
 		break;
@@ -1334,6 +1443,9 @@ static ssize_t dvb_ca_en50221_io_write(struct file *file,
 			status = dvb_ca_en50221_write_data(ca, slot, fragbuf, fraglen + 2);
 			mutex_unlock(&ca->slot_info[slot].slot_lock);
 			if (status == (fraglen + 2)) {
+				/* a reply is expected soon, poll at full rate */
+				ca->slot_info[slot].idle_polls = 0;
+				dvb_ca_en50221_thread_wakeup(ca);
 				written = 1;
 				break;
 			}
@@ -1617,6 +1729,40 @@ static unsigned int dvb_ca_en50221_io_poll(struct file *file, poll_table * wait)
 EXPORT_SYMBOL(dvb_ca_en50221_init);
 
 
+static int dvb_ca_en50221_debugfs_show(struct seq_file *m, void *v)
+{
+	struct dvb_ca_private *ca = m->private;
+	struct dvb_ca_slot *sl;
+	int slot;
+
+	seq_printf(m, "flags: 0x%x, poll delay: %lu ms\n", ca->flags,
+		   (unsigned long)jiffies_to_msecs(ca->delay));
+	for (slot = 0; slot < ca->slot_count; slot++) {
+		sl = &ca->slot_info[slot];
+		seq_printf(m, "slot %d: state %d, da irq %d\n", slot,
+			   sl->slot_state, sl->da_irq_supported);
+		seq_printf(m, "  status polls: %lu\n", sl->status_polls);
+		seq_printf(m, "  data reads:   %lu\n", sl->data_reads);
+		seq_printf(m, "  idle polls:   %u\n", sl->idle_polls);
+		seq_printf(m, "  slot polls:   %lu\n", sl->slot_polls);
+		seq_printf(m, "  irqs:         %lu\n", sl->irqs);
+	}
+	return 0;
+}
+
+static int dvb_ca_en50221_debugfs_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, dvb_ca_en50221_debugfs_show, inode->i_private);
+}
+
+static const struct file_operations dvb_ca_debugfs_fops = {
+	.owner		= THIS_MODULE,
+	.open		= dvb_ca_en50221_debugfs_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 static const struct file_operations dvb_ca_fops = {
 	.owner = THIS_MODULE,
 	.read = dvb_ca_en50221_io_read,
@@ -1701,6 +1847,15 @@ int dvb_ca_en50221_init(struct dvb_adapter *dvb_adapter,
 	}
 	mb();
 
+	if (dvb_adapter->debugfs_dir) {
+		char name[16];
+
+		snprintf(name, sizeof(name), "ca%d", ca->dvbdev->id);
+		ca->debugfs = debugfs_create_file(name, 0444,
+						  dvb_adapter->debugfs_dir, ca,
+						  &dvb_ca_debugfs_fops);
+	}
+
 	/* create a kthread for monitoring this CA device */
 	ca->thread = kthread_run(dvb_ca_en50221_thread, ca, "kdvb-ca-%i:%i",
 				 ca->dvbdev->adapter->num, ca->dvbdev->id);
@@ -1714,6 +1869,8 @@ int dvb_ca_en50221_init(struct dvb_adapter *dvb_adapter,
 
 error:
 	if (ca != NULL) {
+		if (!IS_ERR_OR_NULL(ca->debugfs))
+			debugfs_remove(ca->debugfs);
 		if (ca->dvbdev != NULL)
 			dvb_unregister_device(ca->dvbdev);
 		kfree(ca->slot_info);
@@ -1739,6 +1896,9 @@ void dvb_ca_en50221_release(struct dvb_ca_en50221 *pubca)
 
 	dprintk("%s\n", __func__);
 
+	if (!IS_ERR_OR_NULL(ca->debugfs))
+		debugfs_remove(ca->debugfs);
+
 	/* shutdown the thread if there was one */
 	kthread_stop(ca->thread);
 
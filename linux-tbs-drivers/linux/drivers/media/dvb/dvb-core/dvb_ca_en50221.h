@@ -33,6 +33,7 @@
 #define DVB_CA_EN50221_FLAG_IRQ_CAMCHANGE	1
 #define DVB_CA_EN50221_FLAG_IRQ_FR		2
 #define DVB_CA_EN50221_FLAG_IRQ_DA		4
+#define DVB_CA_EN50221_FLAG_IRQ_POLL		8
 
 #define DVB_CA_EN50221_CAMCHANGE_REMOVED		0
 #define DVB_CA_EN50221_CAMCHANGE_INSERTED		1
@@ -58,11 +59,28 @@ struct dvb_ca_en50221 {
 	int (*read_cam_control)(struct dvb_ca_en50221* ca, int slot, u8 address);
 	int (*write_cam_control)(struct dvb_ca_en50221* ca, int slot, u8 address, u8 value);
 
+	/*
+	 * Optional: transfer count bytes through the CAM data register
+	 * (CTRLIF_DATA) in one go. Return the number of bytes transferred,
+	 * or < 0 on error. If not set, read_cam_control/write_cam_control
+	 * are called once per byte.
+	 */
+	int (*read_cam_data)(struct dvb_ca_en50221* ca, int slot, u8 *buf, int count);
+	int (*write_cam_data)(struct dvb_ca_en50221* ca, int slot, const u8 *buf, int count);
+
 	/* Functions for controlling slots */
 	int (*slot_reset)(struct dvb_ca_en50221* ca, int slot);
 	int (*slot_shutdown)(struct dvb_ca_en50221* ca, int slot);
 	int (*slot_ts_enable)(struct dvb_ca_en50221* ca, int slot);
 
+	/*
+	 * Optional: feed the TS of a slot around the CAM instead of through
+	 * it (CA_GET/SET_TS_BYPASS). Both return 0 or a negative error code.
+	 * Without them the TS always passes through the CAM.
+	 */
+	int (*get_ts_bypass)(struct dvb_ca_en50221* ca, int slot, int *bypass);
+	int (*set_ts_bypass)(struct dvb_ca_en50221* ca, int slot, int bypass);
+
 	/*
 	* Poll slot status.
 	* Only necessary if DVB_CA_FLAG_EN50221_IRQ_CAMCHANGE is not set
@@ -107,6 +125,17 @@ void dvb_ca_en50221_camready_irq(struct dvb_ca_en50221* pubca, int slot);
  */
 void dvb_ca_en50221_frda_irq(struct dvb_ca_en50221* ca, int slot);
 
+/**
+ * The slot status may have changed (e.g. a card detect line toggled).
+ * Makes the thread call poll_slot_status() now. Interfaces that report
+ * this set DVB_CA_EN50221_FLAG_IRQ_POLL and are otherwise polled rarely.
+ * May be called from interrupt context.
+ *
+ * @param ca CA instance.
+ * @param slot Slot concerned.
+ */
+void dvb_ca_en50221_poll_irq(struct dvb_ca_en50221* ca, int slot);
+
 
 
 /* ******************************************************************************** */
@@ -128,6 +128,121 @@ static inline int dvb_dmx_swfilter_payload(struct dvb_demux_feed *feed,
 	return feed->cb.ts(&buf[p], count, NULL, 0, &feed->feed.ts, DMX_OK);
 }
 
+/*
+ * PES assembly: wait for a PUSI, collect the payload of the PID and pass
+ * the packet on once its PES_packet_length is reached or, for unbounded
+ * video PES, when the next one starts. Continuity is checked while a
+ * packet is being collected; a gap drops it and flags the next one.
+ */
+#define PES_WAIT	0	/* not in sync, drop until the next PUSI */
+#define PES_COPY	1	/* collecting a packet */
+#define PES_DONE	2	/* bounded packet passed on, wait for PUSI */
+
+static inline u64 pes_timestamp(const u8 *buf)
+{
+	return ((u64)(buf[0] & 0x0e) << 29) | (buf[1] << 22) |
+	       ((buf[2] & 0xfe) << 14) | (buf[3] << 7) | (buf[4] >> 1);
+}
+
+static void dvb_dmx_pes_deliver(struct dvb_demux_feed *feed)
+{
+	struct dmx_pes_info info;
+	const u8 *pes = feed->pesbuf;
+	size_t len = feed->pesbufp;
+	u8 stream_id = pes[3];
+
+	info.length = len;
+	info.pid = feed->pid;
+	info.flags = feed->pes_flags;
+	info.pts = 0;
+	info.dts = 0;
+
+	/* streams without the optional PES header, see ISO 13818-1 2.4.3.7 */
+	if (stream_id != 0xbc && stream_id != 0xbe && stream_id != 0xbf &&
+	    stream_id != 0xf0 && stream_id != 0xf1 && stream_id != 0xf2 &&
+	    stream_id != 0xf8 && stream_id != 0xff &&
+	    len >= 9 && (pes[6] & 0xc0) == 0x80) {
+		if ((pes[7] & 0x80) && len >= 14) {
+			info.pts = pes_timestamp(&pes[9]);
+			info.flags |= DMX_PES_PTS_VALID;
+		}
+		if ((pes[7] & 0xc0) == 0xc0 && len >= 19) {
+			info.dts = pes_timestamp(&pes[14]);
+			info.flags |= DMX_PES_DTS_VALID;
+		}
+	}
+
+	feed->cb.ts((u8 *)&info, sizeof(info), pes, len, &feed->feed.ts,
+		    DMX_OK);
+
+	feed->pesbufp = 0;
+	feed->pes_flags = 0;
+}
+
+static void dvb_dmx_pes_lost(struct dvb_demux_feed *feed)
+{
+	feed->pes_state = PES_WAIT;
+	feed->pesbufp = 0;
+	feed->pes_flags = DMX_PES_DISCONTINUITY;
+}
+
+static void dvb_dmx_swfilter_pes(struct dvb_demux_feed *feed, const u8 *buf)
+{
+	int count = payload(buf);
+	int p, dc_i = 0;
+	size_t peslen;
+	u8 cc;
+
+	if (count == 0)
+		return;
+
+	p = 188 - count;
+	cc = buf[3] & 0x0f;
+
+	if ((buf[3] & 0x20) && buf[4] > 0 && (buf[5] & 0x80))
+		dc_i = 1;
+
+	if (feed->pes_state != PES_WAIT && !dc_i) {
+		if (cc == feed->cc)	/* duplicate packet */
+			return;
+		if (cc != ((feed->cc + 1) & 0x0f))
+			dvb_dmx_pes_lost(feed);
+	}
+	feed->cc = cc;
+
+	if (buf[1] & 0x40) {
+		if (feed->pes_state == PES_COPY)
+			dvb_dmx_pes_deliver(feed);
+
+		if (count < 6 || buf[p] || buf[p + 1] || buf[p + 2] != 0x01) {
+			dvb_dmx_pes_lost(feed);
+			return;
+		}
+
+		feed->pes_state = PES_COPY;
+		if ((buf[3] & 0x20) && buf[4] > 0 && (buf[5] & 0x40))
+			feed->pes_flags |= DMX_PES_RANDOM_ACCESS;
+	} else if (feed->pes_state != PES_COPY) {
+		return;
+	}
+
+	if (feed->pesbufp + count > feed->pesbuf_size) {
+		dvb_dmx_pes_lost(feed);
+		return;
+	}
+
+	memcpy(feed->pesbuf + feed->pesbufp, &buf[p], count);
+	feed->pesbufp += count;
+
+	peslen = (feed->pesbuf[4] << 8) | feed->pesbuf[5];
+	if (peslen && feed->pesbufp >= peslen + 6) {
+		/* anything after the packet is stuffing */
+		feed->pesbufp = peslen + 6;
+		dvb_dmx_pes_deliver(feed);
+		feed->pes_state = PES_DONE;
+	}
+}
+
 static int dvb_dmx_swfilter_sectionfilter(struct dvb_demux_feed *feed,
 					  struct dvb_demux_filter *f)
 {
@@ -359,7 +474,9 @@ static inline void dvb_dmx_swfilter_packet_type(struct dvb_demux_feed *feed,
 		if (!feed->feed.ts.is_filtering)
 			break;
 		if (feed->ts_type & TS_PACKET) {
-			if (feed->ts_type & TS_PAYLOAD_ONLY)
+			if (feed->ts_type & TS_PES)
+				dvb_dmx_swfilter_pes(feed, buf);
+			else if (feed->ts_type & TS_PAYLOAD_ONLY)
 				dvb_dmx_swfilter_payload(feed, buf);
 			else
 				feed->cb.ts(buf, 188, NULL, 0, &feed->feed.ts,
@@ -382,6 +499,33 @@ static inline void dvb_dmx_swfilter_packet_type(struct dvb_demux_feed *feed,
 	}
 }
 
+/* PCR wraps with the 33 bit base */
+#define PCR_WRAP	((1ULL << 33) * 300)
+
+static void dvb_dmx_swfilter_pcr(struct dvb_demux *demux, u16 pid,
+				 const u8 *buf)
+{
+	u64 pcr;
+	int i;
+
+	/* adaptation field long enough to carry a PCR, PCR_flag set */
+	if (buf[4] < 7 || !(buf[5] & 0x10))
+		return;
+
+	for (i = 0; i < DVB_DEMUX_STC_NUM; i++) {
+		if (demux->stc[i].pid != pid)
+			continue;
+
+		pcr = ((u64)buf[6] << 25) | (buf[7] << 17) | (buf[8] << 9) |
+		      (buf[9] << 1) | (buf[10] >> 7);
+		pcr = pcr * 300 + (((buf[10] & 0x01) << 8) | buf[11]);
+
+		demux->stc[i].pcr = pcr;
+		demux->stc[i].stamp = ktime_get();
+		demux->stc[i].valid = 1;
+	}
+}
+
 #define DVR_FEED(f)							\
 	(((f)->type == DMX_TYPE_TS) &&					\
 	((f)->feed.ts.is_filtering) &&					\
@@ -446,6 +590,9 @@ static void dvb_dmx_swfilter_packet(struct dvb_demux *demux, const u8 *buf)
 		/* end check */
 	};
 
+	if (buf[3] & 0x20)
+		dvb_dmx_swfilter_pcr(demux, pid, buf);
+
 	list_for_each_entry(feed, &demux->feed_list, list_head) {
 		if ((feed->pid != pid) && (feed->pid != 0x2000))
 			continue;
@@ -639,12 +786,29 @@ out:
 	spin_unlock_irq(&feed->demux->lock);
 }
 
+static int dvb_dmx_stc_index(enum dmx_ts_pes pes_type)
+{
+	switch (pes_type) {
+	case DMX_TS_PES_PCR0:
+		return 0;
+	case DMX_TS_PES_PCR1:
+		return 1;
+	case DMX_TS_PES_PCR2:
+		return 2;
+	case DMX_TS_PES_PCR3:
+		return 3;
+	default:
+		return -1;
+	}
+}
+
 static int dmx_ts_feed_set(struct dmx_ts_feed *ts_feed, u16 pid, int ts_type,
 			   enum dmx_ts_pes pes_type,
 			   size_t circular_buffer_size, struct timespec timeout)
 {
 	struct dvb_demux_feed *feed = (struct dvb_demux_feed *)ts_feed;
 	struct dvb_demux *demux = feed->demux;
+	int i;
 
 	if (pid > DMX_MAX_PID)
 		return -EINVAL;
@@ -652,6 +816,18 @@ static int dmx_ts_feed_set(struct dmx_ts_feed *ts_feed, u16 pid, int ts_type,
 	if (mutex_lock_interruptible(&demux->mutex))
 		return -ERESTARTSYS;
 
+	vfree(feed->pesbuf);
+	feed->pesbuf = NULL;
+	feed->pesbuf_size = 0;
+	if (ts_type & TS_PES) {
+		feed->pesbuf = vmalloc(circular_buffer_size);
+		if (!feed->pesbuf) {
+			mutex_unlock(&demux->mutex);
+			return -ENOMEM;
+		}
+		feed->pesbuf_size = circular_buffer_size;
+	}
+
 	if (ts_type & TS_DECODER) {
 		if (pes_type >= DMX_TS_PES_OTHER) {
 			mutex_unlock(&demux->mutex);
@@ -666,6 +842,14 @@ static int dmx_ts_feed_set(struct dmx_ts_feed *ts_feed, u16 pid, int ts_type,
 
 		demux->pesfilter[pes_type] = feed;
 		demux->pids[pes_type] = pid;
+
+		i = dvb_dmx_stc_index(pes_type);
+		if (i >= 0) {
+			spin_lock_irq(&demux->lock);
+			demux->stc[i].pid = pid;
+			demux->stc[i].valid = 0;
+			spin_unlock_irq(&demux->lock);
+		}
 	}
 
 	dvb_demux_feed_add(feed);
@@ -719,6 +903,9 @@ static int dmx_ts_feed_start_filtering(struct dmx_ts_feed *ts_feed)
 	}
 
 	spin_lock_irq(&demux->lock);
+	feed->pes_state = PES_WAIT;
+	feed->pesbufp = 0;
+	feed->pes_flags = 0;
 	ts_feed->is_filtering = 1;
 	feed->state = DMX_STATE_GO;
 	spin_unlock_irq(&demux->lock);
@@ -777,6 +964,8 @@ static int dvbdmx_allocate_ts_feed(struct dmx_demux *dmx,
 	feed->pid = 0xffff;
 	feed->peslen = 0xfffa;
 	feed->buffer = NULL;
+	feed->pesbuf = NULL;
+	feed->pesbuf_size = 0;
 
 	(*ts_feed) = &feed->feed.ts;
 	(*ts_feed)->parent = dmx;
@@ -806,6 +995,7 @@ static int dvbdmx_release_ts_feed(struct dmx_demux *dmx,
 {
 	struct dvb_demux *demux = (struct dvb_demux *)dmx;
 	struct dvb_demux_feed *feed = (struct dvb_demux_feed *)ts_feed;
+	int i;
 
 	mutex_lock(&demux->mutex);
 
@@ -823,11 +1013,24 @@ static int dvbdmx_release_ts_feed(struct dmx_demux *dmx,
 
 	dvb_demux_feed_del(feed);
 
+	vfree(feed->pesbuf);
+	feed->pesbuf = NULL;
+	feed->pesbuf_size = 0;
+
 	feed->pid = 0xffff;
 
-	if (feed->ts_type & TS_DECODER && feed->pes_type < DMX_TS_PES_OTHER)
+	if (feed->ts_type & TS_DECODER && feed->pes_type < DMX_TS_PES_OTHER) {
 		demux->pesfilter[feed->pes_type] = NULL;
 
+		i = dvb_dmx_stc_index(feed->pes_type);
+		if (i >= 0) {
+			spin_lock_irq(&demux->lock);
+			demux->stc[i].pid = 0xffff;
+			demux->stc[i].valid = 0;
+			spin_unlock_irq(&demux->lock);
+		}
+	}
+
 	mutex_unlock(&demux->mutex);
 	return 0;
 }
@@ -1119,28 +1322,53 @@ static int dvbdmx_close(struct dmx_demux *demux)
 	return 0;
 }
 
+/*
+ * Memory input goes through a bounce buffer that lives as long as the
+ * demux, one chunk at a time, so large writes need neither a matching
+ * allocation nor a second full copy. A packet split across chunks or
+ * writes is carried over in tsbuf by dvb_dmx_swfilter().
+ *
+ * Writers are serialized by the dmxdev mutex, so the buffer is filled
+ * without the demux mutex and a fault on the user buffer does not hold
+ * up filter changes.
+ */
 static int dvbdmx_write(struct dmx_demux *demux, const char __user *buf, size_t count)
 {
 	struct dvb_demux *dvbdemux = (struct dvb_demux *)demux;
-	void *p;
+	size_t done = 0, n;
+	int ret = 0;
 
 	if ((!demux->frontend) || (demux->frontend->source != DMX_MEMORY_FE))
 		return -EINVAL;
 
-	p = memdup_user(buf, count);
-	if (IS_ERR(p))
-		return PTR_ERR(p);
-	if (mutex_lock_interruptible(&dvbdemux->mutex)) {
-		kfree(p);
-		return -ERESTARTSYS;
+	if (!dvbdemux->write_buf) {
+		dvbdemux->write_buf = vmalloc(DVB_DMX_WRITE_CHUNK);
+		if (!dvbdemux->write_buf)
+			return -ENOMEM;
 	}
-	dvb_dmx_swfilter(dvbdemux, p, count);
-	kfree(p);
-	mutex_unlock(&dvbdemux->mutex);
 
-	if (signal_pending(current))
-		return -EINTR;
-	return count;
+	while (done < count) {
+		n = min_t(size_t, count - done, DVB_DMX_WRITE_CHUNK);
+		if (copy_from_user(dvbdemux->write_buf, buf + done, n)) {
+			ret = -EFAULT;
+			break;
+		}
+
+		if (mutex_lock_interruptible(&dvbdemux->mutex)) {
+			ret = -ERESTARTSYS;
+			break;
+		}
+		dvb_dmx_swfilter(dvbdemux, dvbdemux->write_buf, n);
+		mutex_unlock(&dvbdemux->mutex);
+		done += n;
+
+		if (signal_pending(current)) {
+			ret = -EINTR;
+			break;
+		}
+	}
+
+	return done ? done : ret;
 }
 
 static int dvbdmx_add_frontend(struct dmx_demux *demux,
@@ -1214,6 +1442,44 @@ static int dvbdmx_get_pes_pids(struct dmx_demux *demux, u16 * pids)
 	return 0;
 }
 
+/*
+ * The STC is the last PCR, moved on by the time since it arrived. Memory
+ * input runs at whatever rate it is written, so there it is the last PCR.
+ */
+static int dvbdmx_get_stc(struct dmx_demux *demux, unsigned int num,
+			  u64 *stc, unsigned int *base)
+{
+	struct dvb_demux *dvbdemux = (struct dvb_demux *)demux;
+	struct dvb_demux_stc *s;
+	ktime_t stamp;
+	u64 pcr, ns;
+	int valid;
+
+	if (num >= DVB_DEMUX_STC_NUM)
+		return -EINVAL;
+
+	s = &dvbdemux->stc[num];
+
+	spin_lock_irq(&dvbdemux->lock);
+	valid = s->valid;
+	pcr = s->pcr;
+	stamp = s->stamp;
+	spin_unlock_irq(&dvbdemux->lock);
+
+	if (!valid)
+		return -EAGAIN;
+
+	if (demux->frontend && demux->frontend->source != DMX_MEMORY_FE) {
+		ns = ktime_to_ns(ktime_sub(ktime_get(), stamp));
+		pcr += div64_u64(ns * 27, 1000);
+		pcr -= div64_u64(pcr, PCR_WRAP) * PCR_WRAP;
+	}
+
+	*stc = pcr;
+	*base = 300;	/* 27 MHz */
+	return 0;
+}
+
 int dvb_dmx_init(struct dvb_demux *dvbdemux)
 {
 	int i;
@@ -1245,6 +1511,9 @@ int dvb_dmx_init(struct dvb_demux *dvbdemux)
 	if (!dvbdemux->cnt_storage)
 		printk(KERN_WARNING "Couldn't allocate memory for TS/TEI check. Disabling it\n");
 
+	/* allocated by the first memory input write */
+	dvbdemux->write_buf = NULL;
+
 	INIT_LIST_HEAD(&dvbdemux->frontend_list);
 
 	for (i = 0; i < DMX_TS_PES_OTHER; i++) {
@@ -1252,6 +1521,11 @@ int dvb_dmx_init(struct dvb_demux *dvbdemux)
 		dvbdemux->pids[i] = 0xffff;
 	}
 
+	for (i = 0; i < DVB_DEMUX_STC_NUM; i++) {
+		dvbdemux->stc[i].pid = 0xffff;
+		dvbdemux->stc[i].valid = 0;
+	}
+
 	INIT_LIST_HEAD(&dvbdemux->feed_list);
 
 	dvbdemux->playing = 0;
@@ -1280,6 +1554,7 @@ int dvb_dmx_init(struct dvb_demux *dvbdemux)
 	dmx->connect_frontend = dvbdmx_connect_frontend;
 	dmx->disconnect_frontend = dvbdmx_disconnect_frontend;
 	dmx->get_pes_pids = dvbdmx_get_pes_pids;
+	dmx->get_stc = dvbdmx_get_stc;
 
 	mutex_init(&dvbdemux->mutex);
 	spin_lock_init(&dvbdemux->lock);
@@ -1291,6 +1566,7 @@ EXPORT_SYMBOL(dvb_dmx_init);
 
 void dvb_dmx_release(struct dvb_demux *dvbdemux)
 {
+	vfree(dvbdemux->write_buf);
 	vfree(dvbdemux->cnt_storage);
 	vfree(dvbdemux->filter);
 	vfree(dvbdemux->feed);
@@ -24,6 +24,7 @@
 #define _DVB_DEMUX_H_
 
 #include <linux/time.h>
+#include <linux/ktime.h>
 #include <linux/timer.h>
 #include <linux/spinlock.h>
 #include <linux/mutex.h>
@@ -62,6 +63,16 @@ struct dvb_demux_filter {
 	struct timer_list timer;
 };
 
+/* system time clock recovered from the PCRs of one DMX_TS_PES_PCRn feed */
+struct dvb_demux_stc {
+	u16 pid;		/* 0xffff if unused */
+	int valid;
+	u64 pcr;		/* last PCR, 27 MHz */
+	ktime_t stamp;		/* when it arrived */
+};
+
+#define DVB_DEMUX_STC_NUM 4
+
 #define DMX_FEED_ENTRY(pos) list_entry(pos, struct dvb_demux_feed, list_head)
 
 struct dvb_demux_feed {
@@ -94,6 +105,13 @@ struct dvb_demux_feed {
 
 	u16 peslen;
 
+	/* PES assembly for TS_PES feeds */
+	u8 *pesbuf;
+	size_t pesbuf_size;
+	size_t pesbufp;
+	int pes_state;
+	u16 pes_flags;		/* dmx_pes_info flags of the packet in progress */
+
 	struct list_head list_head;
 	unsigned int index;	/* a unique index for each feed (can be used as hardware pid filter index) */
 };
@@ -121,6 +139,7 @@ struct dvb_demux {
 
 	struct dvb_demux_feed *pesfilter[DMX_TS_PES_OTHER];
 	u16 pids[DMX_TS_PES_OTHER];
+	struct dvb_demux_stc stc[DVB_DEMUX_STC_NUM];
 	int playing;
 	int recording;
 
@@ -129,6 +148,10 @@ struct dvb_demux {
 	u8 tsbuf[204];
 	int tsbufp;
 
+	/* bounce buffer for memory input, see dvbdmx_write() */
+#define DVB_DMX_WRITE_CHUNK (256 * 188)
+	u8 *write_buf;
+
 	struct mutex mutex;
 	spinlock_t lock;
 
@@ -37,7 +37,10 @@
 #include <linux/freezer.h>
 #include <linux/jiffies.h>
 #include <linux/kthread.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 #include <asm/processor.h>
+#include <asm/div64.h>
 
 #include "dvb_frontend.h"
 #include "dvbdev.h"
@@ -49,6 +52,11 @@ static int dvb_force_auto_inversion;
 static int dvb_override_tune_delay;
 static int dvb_powerdown_on_sleep = 1;
 static int dvb_mfe_wait_time = 5;
+static int dvb_stats_interval = 1000;
+static int dvb_event_queue_len = MAX_EVENT;
+static int dvb_fast_retune = 1;
+static int dvb_idle_after = 10;
+static int dvb_idle_poll_interval = 30;
 
 module_param_named(frontend_debug, dvb_frontend_debug, int, 0644);
 MODULE_PARM_DESC(frontend_debug, "Turn on/off frontend core debugging (default:off).");
@@ -62,6 +70,16 @@ module_param(dvb_powerdown_on_sleep, int, 0644);
 MODULE_PARM_DESC(dvb_powerdown_on_sleep, "0: do not power down, 1: turn LNB voltage off on sleep (default)");
 module_param(dvb_mfe_wait_time, int, 0644);
 MODULE_PARM_DESC(dvb_mfe_wait_time, "Wait up to <mfe_wait_time> seconds on open() for multi-frontend to become available (default:5 seconds)");
+module_param(dvb_stats_interval, int, 0644);
+MODULE_PARM_DESC(dvb_stats_interval, "Re-read signal statistics from the demodulator at most every <stats_interval> milliseconds, 0 disables the cache (default:1000)");
+module_param(dvb_event_queue_len, int, 0444);
+MODULE_PARM_DESC(dvb_event_queue_len, "Number of status events each frontend queues for FE_GET_EVENT (default:8, max:1024)");
+module_param(dvb_fast_retune, int, 0644);
+MODULE_PARM_DESC(dvb_fast_retune, "0: always fully retune, 1: skip or shorten DTV_TUNE on a locked multiplex when parameters are unchanged (default)");
+module_param(dvb_idle_after, int, 0644);
+MODULE_PARM_DESC(dvb_idle_after, "Back off status polling once the lock was stable and nobody used the frontend for <idle_after> seconds, 0 disables idling (default:10)");
+module_param(dvb_idle_poll_interval, int, 0644);
+MODULE_PARM_DESC(dvb_idle_poll_interval, "Poll the status of an idle frontend every <idle_poll_interval> seconds, 0 stops polling until the frontend is used again (default:30)");
 
 #define dprintk if (dvb_frontend_debug) printk
 
@@ -99,8 +117,38 @@ MODULE_PARM_DESC(dvb_mfe_wait_time, "Wait up to <mfe_wait_time> seconds on open(
 #define DVB_FE_NORMAL_EXIT	1
 #define DVB_FE_DEVICE_REMOVED	2
 
+#define DVB_FE_STATS_STRENGTH	0x01
+#define DVB_FE_STATS_SNR	0x02
+#define DVB_FE_STATS_BER	0x04
+#define DVB_FE_STATS_UCBLOCKS	0x08
+#define DVB_FE_STATS_CACHED	0x80
+
+/* readers which went quiet for this many intervals no longer make the
+ * frontend thread refresh the statistics cache */
+#define DVB_FE_STATS_READER_IDLE	4
+
+#define DVB_FE_MAX_EVENT_QUEUE	1024
+
+/* property batches up to this size don't need a kmalloc() per ioctl */
+#define DVB_FE_PROP_PREALLOC	16
+
+/* retune to FE_HAS_LOCK latency histogram, bucket n counts locks that
+ * took less than (16 << n) ms, the last one everything slower */
+#define DVB_FE_LOCK_HIST_BUCKETS	12
+#define DVB_FE_LOCK_HIST_BASE_MS	16
+
 static DEFINE_MUTEX(frontend_mutex);
 
+/* hooks outside dvb_frontend_ops, see dvb_frontend_set_partial_tune() */
+struct dvb_frontend_hook {
+	struct list_head list;
+	struct dvb_frontend *fe;
+	int (*partial_tune)(struct dvb_frontend *fe, unsigned int changed);
+};
+
+static LIST_HEAD(frontend_hooks);
+static DEFINE_MUTEX(frontend_hook_mutex);
+
 struct dvb_frontend_private {
 
 	/* thread/frontend values */
@@ -136,15 +184,108 @@ struct dvb_frontend_private {
 	int quality;
 	unsigned int check_wrapped;
 	enum dvbfe_search algo_status;
+
+	/* statistics cache */
+	unsigned long stats_jiffies;
+	unsigned long stats_reader_jiffies;
+	unsigned int stats_valid;
+	u16 stats_strength;
+	u16 stats_snr;
+	u32 stats_ber;
+	u32 stats_ucblocks;
+	struct dtv_fe_stats st_strength;	/* DVBv5 view of the above */
+	struct dtv_fe_stats st_cnr;
+	struct dtv_fe_stats st_pre_bit_error;
+	struct dtv_fe_stats st_pre_bit_count;
+	struct dtv_fe_stats st_post_bit_error;
+	struct dtv_fe_stats st_post_bit_count;
+	struct dtv_fe_stats st_block_error;
+	struct dtv_fe_stats st_block_count;
+
+	/* lock latency tracing */
+	struct dentry *debugfs;
+	ktime_t tune_start;
+	unsigned int tune_pending;
+	fe_status_t trace_status;
+	u32 retunes;
+	u32 locks;
+	u32 lock_losses;
+	u32 event_overflows;
+	u32 lock_ms_min;
+	u32 lock_ms_max;
+	u64 lock_ms_total;
+	u32 lock_hist[DVB_FE_LOCK_HIST_BUCKETS];
+
+	/* idle mode */
+	unsigned long activity_jiffies;
+	unsigned long status_jiffies;
+	unsigned int idle;
+	u32 idle_entries;
+
+	/* parameters of the last full tune, for DTV_TUNE diffing */
+	struct dtv_frontend_properties tuned;
+	unsigned int tuned_valid;
+
+	/* FE_[GS]ET_PROPERTY scratch space, protected by sem */
+	struct dtv_property props[DVB_FE_PROP_PREALLOC];
+	struct dtv_frontend_properties snapshot;
 };
 
 static void dvb_frontend_wakeup(struct dvb_frontend *fe);
 
+static void dvb_frontend_trace_retune(struct dvb_frontend *fe)
+{
+	struct dvb_frontend_private *fepriv = fe->frontend_priv;
+
+	fepriv->tune_start = ktime_get();
+	fepriv->tune_pending = 1;
+	fepriv->trace_status = 0;
+	fepriv->retunes++;
+}
+
+/* account lock acquisition and loss for a status transition at @now */
+static void dvb_frontend_trace_status(struct dvb_frontend *fe,
+				      fe_status_t status, ktime_t now)
+{
+	struct dvb_frontend_private *fepriv = fe->frontend_priv;
+	int had_lock = fepriv->trace_status & FE_HAS_LOCK;
+	u64 ms;
+	int i;
+
+	fepriv->trace_status = status;
+
+	if (had_lock && !(status & FE_HAS_LOCK)) {
+		fepriv->lock_losses++;
+		return;
+	}
+
+	if (had_lock || !(status & FE_HAS_LOCK) || !fepriv->tune_pending)
+		return;
+
+	fepriv->tune_pending = 0;
+	fepriv->locks++;
+
+	ms = ktime_to_ns(ktime_sub(now, fepriv->tune_start));
+	do_div(ms, NSEC_PER_MSEC);
+
+	if (fepriv->locks == 1 || ms < fepriv->lock_ms_min)
+		fepriv->lock_ms_min = ms;
+	if (ms > fepriv->lock_ms_max)
+		fepriv->lock_ms_max = ms;
+	fepriv->lock_ms_total += ms;
+
+	for (i = 0; i < DVB_FE_LOCK_HIST_BUCKETS - 1; i++)
+		if (ms < (DVB_FE_LOCK_HIST_BASE_MS << i))
+			break;
+	fepriv->lock_hist[i]++;
+}
+
 static void dvb_frontend_add_event(struct dvb_frontend *fe, fe_status_t status)
 {
 	struct dvb_frontend_private *fepriv = fe->frontend_priv;
 	struct dvb_fe_events *events = &fepriv->events;
 	struct dvb_frontend_event *e;
+	ktime_t now = ktime_get();
 	int wp;
 
 	dprintk ("%s\n", __func__);
@@ -152,11 +293,15 @@ static void dvb_frontend_add_event(struct dvb_frontend *fe, fe_status_t status)
 	if (mutex_lock_interruptible (&events->mtx))
 		return;
 
-	wp = (events->eventw + 1) % MAX_EVENT;
+	dvb_frontend_trace_status(fe, status, now);
+	fepriv->status_jiffies = jiffies;
+
+	wp = (events->eventw + 1) % events->size;
 
 	if (wp == events->eventr) {
 		events->overflow = 1;
-		events->eventr = (events->eventr + 1) % MAX_EVENT;
+		events->eventr = (events->eventr + 1) % events->size;
+		fepriv->event_overflows++;
 	}
 
 	e = &events->events[events->eventw];
@@ -166,13 +311,13 @@ static void dvb_frontend_add_event(struct dvb_frontend *fe, fe_status_t status)
 			fe->ops.get_frontend(fe, &fepriv->parameters_out);
 
 	e->parameters = fepriv->parameters_out;
+	e->status = status;
+	events->timestamps[events->eventw] = now;
 
 	events->eventw = wp;
 
 	mutex_unlock(&events->mtx);
 
-	e->status = status;
-
 	wake_up_interruptible (&events->wait_queue);
 }
 
@@ -213,7 +358,7 @@ static int dvb_frontend_get_event(struct dvb_frontend *fe,
 	memcpy (event, &events->events[events->eventr],
 		sizeof(struct dvb_frontend_event));
 
-	events->eventr = (events->eventr + 1) % MAX_EVENT;
+	events->eventr = (events->eventr + 1) % events->size;
 
 	mutex_unlock(&events->mtx);
 
@@ -243,10 +388,131 @@ void dvb_frontend_reinitialise(struct dvb_frontend *fe)
 	struct dvb_frontend_private *fepriv = fe->frontend_priv;
 
 	fepriv->reinitialise = 1;
+	fepriv->tuned_valid = 0;
 	dvb_frontend_wakeup(fe);
 }
 EXPORT_SYMBOL(dvb_frontend_reinitialise);
 
+static void dtv_stats_set(struct dtv_fe_stats *st, u8 scale, u64 value)
+{
+	st->len = 1;
+	st->stat[0].scale = scale;
+	st->stat[0].uvalue = value;
+}
+
+static void dvb_frontend_clear_stats(struct dvb_frontend *fe)
+{
+	struct dvb_frontend_private *fepriv = fe->frontend_priv;
+
+	dtv_stats_set(&fepriv->st_strength, FE_SCALE_NOT_AVAILABLE, 0);
+	dtv_stats_set(&fepriv->st_cnr, FE_SCALE_NOT_AVAILABLE, 0);
+	dtv_stats_set(&fepriv->st_pre_bit_error, FE_SCALE_NOT_AVAILABLE, 0);
+	dtv_stats_set(&fepriv->st_pre_bit_count, FE_SCALE_NOT_AVAILABLE, 0);
+	dtv_stats_set(&fepriv->st_post_bit_error, FE_SCALE_NOT_AVAILABLE, 0);
+	dtv_stats_set(&fepriv->st_post_bit_count, FE_SCALE_NOT_AVAILABLE, 0);
+	dtv_stats_set(&fepriv->st_block_error, FE_SCALE_NOT_AVAILABLE, 0);
+	dtv_stats_set(&fepriv->st_block_count, FE_SCALE_NOT_AVAILABLE, 0);
+
+	fepriv->stats_valid = 0;
+}
+
+static int dvb_frontend_stats_stale(struct dvb_frontend_private *fepriv)
+{
+	if (dvb_stats_interval <= 0 || !(fepriv->stats_valid & DVB_FE_STATS_CACHED))
+		return 1;
+
+	return time_after_eq(jiffies, fepriv->stats_jiffies +
+			     msecs_to_jiffies(dvb_stats_interval));
+}
+
+static int dvb_frontend_stats_wanted(struct dvb_frontend_private *fepriv)
+{
+	if (dvb_stats_interval <= 0 || !fepriv->stats_reader_jiffies)
+		return 0;
+
+	return time_before(jiffies, fepriv->stats_reader_jiffies +
+			   DVB_FE_STATS_READER_IDLE *
+			   msecs_to_jiffies(dvb_stats_interval));
+}
+
+/*
+ * Read all statistics from the demodulator in one go and keep them, both
+ * as the raw values returned by the legacy read_* ops and as DVBv5
+ * properties. Must be called with fepriv->sem held, which serialises the
+ * frontend thread against the ioctl paths.
+ */
+static void dvb_frontend_stats_refresh(struct dvb_frontend *fe)
+{
+	struct dvb_frontend_private *fepriv = fe->frontend_priv;
+	fe_status_t s = 0;
+
+	dvb_frontend_clear_stats(fe);
+
+	if (fe->ops.read_status && fe->ops.read_status(fe, &s) < 0)
+		s = 0;
+
+	if (fe->ops.read_signal_strength &&
+	    fe->ops.read_signal_strength(fe, &fepriv->stats_strength) == 0) {
+		fepriv->stats_valid |= DVB_FE_STATS_STRENGTH;
+		dtv_stats_set(&fepriv->st_strength, FE_SCALE_RELATIVE,
+			      fepriv->stats_strength);
+	}
+
+	if (fe->ops.read_snr &&
+	    fe->ops.read_snr(fe, &fepriv->stats_snr) == 0) {
+		fepriv->stats_valid |= DVB_FE_STATS_SNR;
+		if (s & FE_HAS_CARRIER)
+			dtv_stats_set(&fepriv->st_cnr, FE_SCALE_RELATIVE,
+				      fepriv->stats_snr);
+	}
+
+	if (fe->ops.read_ber &&
+	    fe->ops.read_ber(fe, &fepriv->stats_ber) == 0) {
+		fepriv->stats_valid |= DVB_FE_STATS_BER;
+		if (s & FE_HAS_LOCK)
+			dtv_stats_set(&fepriv->st_post_bit_error, FE_SCALE_COUNTER,
+				      fepriv->stats_ber);
+	}
+
+	if (fe->ops.read_ucblocks &&
+	    fe->ops.read_ucblocks(fe, &fepriv->stats_ucblocks) == 0) {
+		fepriv->stats_valid |= DVB_FE_STATS_UCBLOCKS;
+		if (s & FE_HAS_LOCK)
+			dtv_stats_set(&fepriv->st_block_error, FE_SCALE_COUNTER,
+				      fepriv->stats_ucblocks);
+	}
+
+	fepriv->stats_valid |= DVB_FE_STATS_CACHED;
+	fepriv->stats_jiffies = jiffies;
+}
+
+/*
+ * Called by statistics readers: refreshes the cache if it is older than
+ * dvb_stats_interval, so any number of readers cost at most one poll of
+ * the demodulator per interval.
+ */
+static void dvb_frontend_stats_update(struct dvb_frontend *fe)
+{
+	struct dvb_frontend_private *fepriv = fe->frontend_priv;
+
+	fepriv->stats_reader_jiffies = jiffies;
+
+	if (dvb_frontend_stats_stale(fepriv))
+		dvb_frontend_stats_refresh(fe);
+}
+
+static int dvb_frontend_stats_cached(struct dvb_frontend *fe, unsigned int which)
+{
+	struct dvb_frontend_private *fepriv = fe->frontend_priv;
+
+	if (dvb_stats_interval <= 0)
+		return 0;
+
+	dvb_frontend_stats_update(fe);
+
+	return fepriv->stats_valid & which;
+}
+
 static void dvb_frontend_swzigzag_update_delay(struct dvb_frontend_private *fepriv, int locked)
 {
 	int q2;
@@ -533,6 +799,71 @@ static void dvb_frontend_wakeup(struct dvb_frontend *fe)
 	wake_up_interruptible(&fepriv->wait_queue);
 }
 
+/*
+ * A frontend may stop polling its status once the lock has been stable for
+ * a while and nobody is interested: no process waits in FE_GET_EVENT or
+ * poll(), no ioctl arrived recently and nobody reads the statistics.
+ */
+static int dvb_frontend_can_idle(struct dvb_frontend *fe)
+{
+	struct dvb_frontend_private *fepriv = fe->frontend_priv;
+	unsigned long idle_after = dvb_idle_after * HZ;
+
+	if (dvb_idle_after <= 0)
+		return 0;
+
+	/* nobody has it open read/write, let dvb_shutdown_timeout work */
+	if (fepriv->dvbdev->writers == 1)
+		return 0;
+
+	if (!(fepriv->state & FESTATE_TUNED) || !(fepriv->status & FE_HAS_LOCK))
+		return 0;
+
+	if (waitqueue_active(&fepriv->events.wait_queue))
+		return 0;
+
+	if (time_before(jiffies, fepriv->activity_jiffies + idle_after) ||
+	    time_before(jiffies, fepriv->status_jiffies + idle_after))
+		return 0;
+
+	return !dvb_frontend_stats_wanted(fepriv);
+}
+
+static unsigned long dvb_frontend_thread_timeout(struct dvb_frontend *fe)
+{
+	struct dvb_frontend_private *fepriv = fe->frontend_priv;
+
+	if (!dvb_frontend_can_idle(fe)) {
+		fepriv->idle = 0;
+		return fepriv->delay;
+	}
+
+	if (!fepriv->idle) {
+		dprintk("%s: adapter %i frontend %i going idle\n", __func__,
+			fe->dvb->num, fe->id);
+		fepriv->idle = 1;
+		fepriv->idle_entries++;
+	}
+
+	if (dvb_idle_poll_interval <= 0)
+		return MAX_SCHEDULE_TIMEOUT;
+
+	return max_t(unsigned long, fepriv->delay, dvb_idle_poll_interval * HZ);
+}
+
+/* note user activity, and get an idle frontend thread going again */
+static void dvb_frontend_activity(struct dvb_frontend *fe)
+{
+	struct dvb_frontend_private *fepriv = fe->frontend_priv;
+
+	fepriv->activity_jiffies = jiffies;
+
+	if (fepriv->idle) {
+		fepriv->idle = 0;
+		dvb_frontend_wakeup(fe);
+	}
+}
+
 static int dvb_frontend_thread(void *data)
 {
 	struct dvb_frontend *fe = data;
@@ -560,7 +891,7 @@ restart:
 		wait_event_interruptible_timeout(fepriv->wait_queue,
 			dvb_frontend_should_wakeup(fe) || kthread_should_stop()
 				|| freezing(current),
-			fepriv->delay);
+			dvb_frontend_thread_timeout(fe));
 
 		if (kthread_should_stop() || dvb_frontend_is_exiting(fe)) {
 			/* got signal or quitting */
@@ -662,6 +993,12 @@ restart:
 		} else {
 			dvb_frontend_swzigzag(fe);
 		}
+
+		/* keep the statistics cache warm while somebody reads it */
+		if (!(fepriv->state & (FESTATE_IDLE | FESTATE_RETUNE | FESTATE_ERROR)) &&
+		    dvb_frontend_stats_wanted(fepriv) &&
+		    dvb_frontend_stats_stale(fepriv))
+			dvb_frontend_stats_refresh(fe);
 	}
 
 	if (dvb_powerdown_on_sleep) {
@@ -705,6 +1042,7 @@ static void dvb_frontend_stop(struct dvb_frontend *fe)
 
 	sema_init(&fepriv->sem, 1);
 	fepriv->state = FESTATE_IDLE;
+	fepriv->tuned_valid = 0;
 
 	/* paranoia check in case a signal arrived */
 	if (fepriv->thread)
@@ -776,6 +1114,7 @@ static int dvb_frontend_start(struct dvb_frontend *fe)
 		return -EINTR;
 
 	fepriv->state = FESTATE_IDLE;
+	fepriv->tuned_valid = 0;
 	fepriv->exit = DVB_FE_NO_EXIT;
 	fepriv->thread = NULL;
 	mb();
@@ -894,6 +1233,8 @@ static int dvb_frontend_clear_cache(struct dvb_frontend *fe)
 		c->layer[i].segment_count = -1;
 	}
 
+	dvb_frontend_clear_stats(fe);
+
 	return 0;
 }
 
@@ -977,6 +1318,16 @@ static struct dtv_cmds_h dtv_cmds[DTV_MAX_COMMAND + 1] = {
 	_DTV_CMD(DTV_GUARD_INTERVAL, 0, 0),
 	_DTV_CMD(DTV_TRANSMISSION_MODE, 0, 0),
 	_DTV_CMD(DTV_HIERARCHY, 0, 0),
+
+	/* Statistics API */
+	_DTV_CMD(DTV_STAT_SIGNAL_STRENGTH, 0, 0),
+	_DTV_CMD(DTV_STAT_CNR, 0, 0),
+	_DTV_CMD(DTV_STAT_PRE_ERROR_BIT_COUNT, 0, 0),
+	_DTV_CMD(DTV_STAT_PRE_TOTAL_BIT_COUNT, 0, 0),
+	_DTV_CMD(DTV_STAT_POST_ERROR_BIT_COUNT, 0, 0),
+	_DTV_CMD(DTV_STAT_POST_TOTAL_BIT_COUNT, 0, 0),
+	_DTV_CMD(DTV_STAT_ERROR_BLOCK_COUNT, 0, 0),
+	_DTV_CMD(DTV_STAT_TOTAL_BLOCK_COUNT, 0, 0),
 };
 
 static void dtv_property_dump(struct dtv_property *tvp)
@@ -1165,9 +1516,53 @@ static void dtv_property_adv_params_sync(struct dvb_frontend *fe)
 	}
 }
 
-static void dtv_property_cache_submit(struct dvb_frontend *fe)
+/* Returns the DVBFE_CHANGED_* set describing how @c differs from @t */
+static unsigned int dtv_property_cache_diff(const struct dtv_frontend_properties *c,
+					    const struct dtv_frontend_properties *t)
+{
+	unsigned int changed = 0;
+
+	if (c->delivery_system != t->delivery_system ||
+	    c->frequency != t->frequency ||
+	    c->modulation != t->modulation ||
+	    c->inversion != t->inversion ||
+	    c->fec_inner != t->fec_inner ||
+	    c->transmission_mode != t->transmission_mode ||
+	    c->bandwidth_hz != t->bandwidth_hz ||
+	    c->guard_interval != t->guard_interval ||
+	    c->hierarchy != t->hierarchy ||
+	    c->symbol_rate != t->symbol_rate ||
+	    c->code_rate_HP != t->code_rate_HP ||
+	    c->code_rate_LP != t->code_rate_LP ||
+	    c->pilot != t->pilot ||
+	    c->rolloff != t->rolloff ||
+	    c->voltage != t->voltage ||
+	    c->sectone != t->sectone ||
+	    c->isdbt_partial_reception != t->isdbt_partial_reception ||
+	    c->isdbt_sb_mode != t->isdbt_sb_mode ||
+	    c->isdbt_sb_subchannel != t->isdbt_sb_subchannel ||
+	    c->isdbt_sb_segment_idx != t->isdbt_sb_segment_idx ||
+	    c->isdbt_sb_segment_count != t->isdbt_sb_segment_count ||
+	    c->isdbt_layer_enabled != t->isdbt_layer_enabled ||
+	    memcmp(c->layer, t->layer, sizeof(c->layer)) ||
+	    c->isdbs_ts_id != t->isdbs_ts_id)
+		changed |= DVBFE_CHANGED_OTHER;
+
+	if (c->dvbt2_plp_id != t->dvbt2_plp_id)
+		changed |= DVBFE_CHANGED_STREAM_ID;
+
+	return changed;
+}
+
+/*
+ * Prepare the legacy parameters for the tune request and return which
+ * parameters changed compared to the last full tune, or
+ * DVBFE_CHANGED_OTHER if that is unknown.
+ */
+static unsigned int dtv_property_cache_submit(struct dvb_frontend *fe)
 {
 	const struct dtv_frontend_properties *c = &fe->dtv_property_cache;
+	struct dvb_frontend_private *fepriv = fe->frontend_priv;
 
 	/* For legacy delivery systems we don't need the delivery_system to
 	 * be specified, but we populate the older structures from the cache
@@ -1189,6 +1584,108 @@ static void dtv_property_cache_submit(struct dvb_frontend *fe)
 		 */
 		dtv_property_adv_params_sync(fe);
 	}
+
+	if (!fepriv->tuned_valid)
+		return DVBFE_CHANGED_OTHER;
+
+	return dtv_property_cache_diff(c, &fepriv->tuned);
+}
+
+int dvb_frontend_set_partial_tune(struct dvb_frontend *fe,
+	int (*partial_tune)(struct dvb_frontend *fe, unsigned int changed))
+{
+	struct dvb_frontend_hook *hook;
+
+	mutex_lock(&frontend_hook_mutex);
+	list_for_each_entry(hook, &frontend_hooks, list)
+		if (hook->fe == fe)
+			goto found;
+
+	hook = kzalloc(sizeof(*hook), GFP_KERNEL);
+	if (!hook) {
+		mutex_unlock(&frontend_hook_mutex);
+		return -ENOMEM;
+	}
+	hook->fe = fe;
+	list_add(&hook->list, &frontend_hooks);
+found:
+	hook->partial_tune = partial_tune;
+	mutex_unlock(&frontend_hook_mutex);
+	return 0;
+}
+EXPORT_SYMBOL(dvb_frontend_set_partial_tune);
+
+static void dvb_frontend_drop_hooks(struct dvb_frontend *fe)
+{
+	struct dvb_frontend_hook *hook, *tmp;
+
+	mutex_lock(&frontend_hook_mutex);
+	list_for_each_entry_safe(hook, tmp, &frontend_hooks, list) {
+		if (hook->fe == fe) {
+			list_del(&hook->list);
+			kfree(hook);
+		}
+	}
+	mutex_unlock(&frontend_hook_mutex);
+}
+
+static int dvb_frontend_partial_tune(struct dvb_frontend *fe,
+				     unsigned int changed)
+{
+	int (*partial_tune)(struct dvb_frontend *fe, unsigned int changed);
+	struct dvb_frontend_hook *hook;
+
+	partial_tune = NULL;
+	mutex_lock(&frontend_hook_mutex);
+	list_for_each_entry(hook, &frontend_hooks, list)
+		if (hook->fe == fe)
+			partial_tune = hook->partial_tune;
+	mutex_unlock(&frontend_hook_mutex);
+
+	if (!partial_tune)
+		return -EOPNOTSUPP;
+	return partial_tune(fe, changed);
+}
+
+/*
+ * Complete a DTV_TUNE without reprogramming the tuner when the frontend is
+ * locked and the request either repeats the current parameters or only
+ * selects another stream which the driver can switch to on its own.
+ * Returns 1 if the request was handled, 0 if a full retune is needed.
+ */
+static int dvb_frontend_fast_tune(struct dvb_frontend *fe, unsigned int changed)
+{
+	struct dvb_frontend_private *fepriv = fe->frontend_priv;
+	fe_status_t s = fepriv->status;
+
+	if (!dvb_fast_retune || fe->dvb->fe_ioctl_override)
+		return 0;
+
+	if (fepriv->tune_mode_flags & FE_TUNE_MODE_ONESHOT)
+		return 0;
+
+	if (!(fepriv->state & FESTATE_TUNED) || !(fepriv->status & FE_HAS_LOCK))
+		return 0;
+
+	if (changed & ~DVBFE_CHANGED_STREAM_ID)
+		return 0;
+
+	if (changed) {
+		if (dvb_frontend_partial_tune(fe, changed) < 0)
+			return 0;
+		if (fe->ops.read_status && fe->ops.read_status(fe, &s) < 0)
+			s = 0;
+		fepriv->stats_valid = 0;
+	}
+
+	dprintk("%s() changed=0x%x, status=0x%02x\n", __func__, changed, s);
+
+	fepriv->tuned = fe->dtv_property_cache;
+	dvb_frontend_trace_retune(fe);
+	dvb_frontend_add_event(fe, s);
+	fepriv->status = s;
+
+	return 1;
 }
 
 static int dvb_frontend_ioctl_legacy(struct file *file,
@@ -1196,24 +1693,51 @@ static int dvb_frontend_ioctl_legacy(struct file *file,
 static int dvb_frontend_ioctl_properties(struct file *file,
 			unsigned int cmd, void *parg);
 
-static int dtv_property_process_get(struct dvb_frontend *fe,
-				    struct dtv_property *tvp,
-				    struct file *file)
+static int dtv_property_is_stat(u32 cmd)
+{
+	return cmd >= DTV_STAT_SIGNAL_STRENGTH &&
+	       cmd <= DTV_STAT_TOTAL_BLOCK_COUNT;
+}
+
+/*
+ * Take one consistent view of the tuning parameters and, if any of the
+ * @num properties asks for them, the statistics. All properties of a
+ * FE_GET_PROPERTY call are answered from it.
+ */
+static const struct dtv_frontend_properties *
+dtv_property_snapshot(struct dvb_frontend *fe,
+		      const struct dtv_property *tvp, int num)
 {
-	const struct dtv_frontend_properties *c = &fe->dtv_property_cache;
 	struct dvb_frontend_private *fepriv = fe->frontend_priv;
-	struct dtv_frontend_properties cdetected;
-	int r;
+	struct dtv_frontend_properties *c = &fepriv->snapshot;
+	int i;
+
+	for (i = 0; i < num; i++) {
+		if (dtv_property_is_stat(tvp[i].cmd)) {
+			dvb_frontend_stats_update(fe);
+			break;
+		}
+	}
+
+	*c = fe->dtv_property_cache;
 
 	/*
 	 * If the driver implements a get_frontend function, then convert
 	 * detected parameters to S2API properties.
 	 */
-	if (fe->ops.get_frontend) {
-		cdetected = *c;
-		dtv_property_cache_sync(fe, &cdetected, &fepriv->parameters_out);
-		c = &cdetected;
-	}
+	if (fe->ops.get_frontend)
+		dtv_property_cache_sync(fe, c, &fepriv->parameters_out);
+
+	return c;
+}
+
+static int dtv_property_process_get(struct dvb_frontend *fe,
+				    const struct dtv_frontend_properties *c,
+				    struct dtv_property *tvp,
+				    struct file *file)
+{
+	struct dvb_frontend_private *fepriv = fe->frontend_priv;
+	int r;
 
 	switch(tvp->cmd) {
 	case DTV_FREQUENCY:
@@ -1329,6 +1853,32 @@ static int dtv_property_process_get(struct dvb_frontend *fe,
 	case DTV_DVBT2_PLP_ID:
 		tvp->u.data = c->dvbt2_plp_id;
 		break;
+
+	/* Fill quality measures */
+	case DTV_STAT_SIGNAL_STRENGTH:
+		tvp->u.st = fepriv->st_strength;
+		break;
+	case DTV_STAT_CNR:
+		tvp->u.st = fepriv->st_cnr;
+		break;
+	case DTV_STAT_PRE_ERROR_BIT_COUNT:
+		tvp->u.st = fepriv->st_pre_bit_error;
+		break;
+	case DTV_STAT_PRE_TOTAL_BIT_COUNT:
+		tvp->u.st = fepriv->st_pre_bit_count;
+		break;
+	case DTV_STAT_POST_ERROR_BIT_COUNT:
+		tvp->u.st = fepriv->st_post_bit_error;
+		break;
+	case DTV_STAT_POST_TOTAL_BIT_COUNT:
+		tvp->u.st = fepriv->st_post_bit_count;
+		break;
+	case DTV_STAT_ERROR_BLOCK_COUNT:
+		tvp->u.st = fepriv->st_block_error;
+		break;
+	case DTV_STAT_TOTAL_BLOCK_COUNT:
+		tvp->u.st = fepriv->st_block_count;
+		break;
 	default:
 		return -EINVAL;
 	}
@@ -1352,6 +1902,7 @@ static int dtv_property_process_set(struct dvb_frontend *fe,
 	int r = 0;
 	struct dtv_frontend_properties *c = &fe->dtv_property_cache;
 	struct dvb_frontend_private *fepriv = fe->frontend_priv;
+	unsigned int changed;
 	dtv_property_dump(tvp);
 
 	/* Allow the frontend to validate incoming properties */
@@ -1376,7 +1927,10 @@ static int dtv_property_process_set(struct dvb_frontend *fe,
 		 */
 		c->state = tvp->cmd;
 		dprintk("%s() Finalised property cache\n", __func__);
-		dtv_property_cache_submit(fe);
+		changed = dtv_property_cache_submit(fe);
+
+		if (dvb_frontend_fast_tune(fe, changed))
+			break;
 
 		r = dvb_frontend_ioctl_legacy(file, FE_SET_FRONTEND,
 			&fepriv->parameters_in);
@@ -1521,6 +2075,8 @@ static int dvb_frontend_ioctl(struct file *file,
 	     cmd == FE_DISEQC_RECV_SLAVE_REPLY))
 		return -EPERM;
 
+	dvb_frontend_activity(fe);
+
 	if (down_interruptible (&fepriv->sem))
 		return -ERESTARTSYS;
 
@@ -1540,7 +2096,9 @@ static int dvb_frontend_ioctl_properties(struct file *file,
 {
 	struct dvb_device *dvbdev = file->private_data;
 	struct dvb_frontend *fe = dvbdev->priv;
+	struct dvb_frontend_private *fepriv = fe->frontend_priv;
 	struct dtv_frontend_properties *c = &fe->dtv_property_cache;
+	const struct dtv_frontend_properties *snap;
 	int err = 0;
 
 	struct dtv_properties *tvps = NULL;
@@ -1560,10 +2118,14 @@ static int dvb_frontend_ioctl_properties(struct file *file,
 		if ((tvps->num == 0) || (tvps->num > DTV_IOCTL_MAX_MSGS))
 			return -EINVAL;
 
-		tvp = kmalloc(tvps->num * sizeof(struct dtv_property), GFP_KERNEL);
-		if (!tvp) {
-			err = -ENOMEM;
-			goto out;
+		if (tvps->num <= DVB_FE_PROP_PREALLOC) {
+			tvp = fepriv->props;
+		} else {
+			tvp = kmalloc(tvps->num * sizeof(struct dtv_property), GFP_KERNEL);
+			if (!tvp) {
+				err = -ENOMEM;
+				goto out;
+			}
 		}
 
 		if (copy_from_user(tvp, tvps->props, tvps->num * sizeof(struct dtv_property))) {
@@ -1594,10 +2156,14 @@ static int dvb_frontend_ioctl_properties(struct file *file,
 		if ((tvps->num == 0) || (tvps->num > DTV_IOCTL_MAX_MSGS))
 			return -EINVAL;
 
-		tvp = kmalloc(tvps->num * sizeof(struct dtv_property), GFP_KERNEL);
-		if (!tvp) {
-			err = -ENOMEM;
-			goto out;
+		if (tvps->num <= DVB_FE_PROP_PREALLOC) {
+			tvp = fepriv->props;
+		} else {
+			tvp = kmalloc(tvps->num * sizeof(struct dtv_property), GFP_KERNEL);
+			if (!tvp) {
+				err = -ENOMEM;
+				goto out;
+			}
 		}
 
 		if (copy_from_user(tvp, tvps->props, tvps->num * sizeof(struct dtv_property))) {
@@ -1605,8 +2171,10 @@ static int dvb_frontend_ioctl_properties(struct file *file,
 			goto out;
 		}
 
+		snap = dtv_property_snapshot(fe, tvp, tvps->num);
+
 		for (i = 0; i < tvps->num; i++) {
-			err = dtv_property_process_get(fe, tvp + i, file);
+			err = dtv_property_process_get(fe, snap, tvp + i, file);
 			if (err < 0)
 				goto out;
 			(tvp + i)->result = err;
@@ -1621,7 +2189,8 @@ static int dvb_frontend_ioctl_properties(struct file *file,
 		err = -EOPNOTSUPP;
 
 out:
-	kfree(tvp);
+	if (tvp != fepriv->props)
+		kfree(tvp);
 	return err;
 }
 
@@ -1674,22 +2243,34 @@ static int dvb_frontend_ioctl_legacy(struct file *file,
 		break;
 	}
 	case FE_READ_BER:
-		if (fe->ops.read_ber)
+		if (dvb_frontend_stats_cached(fe, DVB_FE_STATS_BER)) {
+			*(__u32 *) parg = fepriv->stats_ber;
+			err = 0;
+		} else if (fe->ops.read_ber)
 			err = fe->ops.read_ber(fe, (__u32*) parg);
 		break;
 
 	case FE_READ_SIGNAL_STRENGTH:
-		if (fe->ops.read_signal_strength)
+		if (dvb_frontend_stats_cached(fe, DVB_FE_STATS_STRENGTH)) {
+			*(__u16 *) parg = fepriv->stats_strength;
+			err = 0;
+		} else if (fe->ops.read_signal_strength)
 			err = fe->ops.read_signal_strength(fe, (__u16*) parg);
 		break;
 
 	case FE_READ_SNR:
-		if (fe->ops.read_snr)
+		if (dvb_frontend_stats_cached(fe, DVB_FE_STATS_SNR)) {
+			*(__u16 *) parg = fepriv->stats_snr;
+			err = 0;
+		} else if (fe->ops.read_snr)
 			err = fe->ops.read_snr(fe, (__u16*) parg);
 		break;
 
 	case FE_READ_UNCORRECTED_BLOCKS:
-		if (fe->ops.read_ucblocks)
+		if (dvb_frontend_stats_cached(fe, DVB_FE_STATS_UCBLOCKS)) {
+			*(__u32 *) parg = fepriv->stats_ucblocks;
+			err = 0;
+		} else if (fe->ops.read_ucblocks)
 			err = fe->ops.read_ucblocks(fe, (__u32*) parg);
 		break;
 
@@ -1882,6 +2463,13 @@ static int dvb_frontend_ioctl_legacy(struct file *file,
 
 		fepriv->state = FESTATE_RETUNE;
 
+		/* statistics of the previous transponder are meaningless now */
+		fepriv->stats_valid = 0;
+		dvb_frontend_trace_retune(fe);
+
+		fepriv->tuned = *c;
+		fepriv->tuned_valid = 1;
+
 		/* Request the search algorithm to search */
 		fepriv->algo_status |= DVBFE_ALGO_SEARCH_AGAIN;
 
@@ -1928,6 +2516,8 @@ static unsigned int dvb_frontend_poll(struct file *file, struct poll_table_struc
 
 	dprintk ("%s\n", __func__);
 
+	dvb_frontend_activity(fe);
+
 	poll_wait (file, &fepriv->events.wait_queue, wait);
 
 	if (fepriv->events.eventw != fepriv->events.eventr)
@@ -1998,11 +2588,14 @@ static int dvb_frontend_open(struct inode *inode, struct file *file)
 		   won't get called (which is what usually does initial
 		   register configuration). */
 		fepriv->reinitialise = 1;
+		fepriv->tuned_valid = 0;
 	}
 
 	if ((ret = dvb_generic_open (inode, file)) < 0)
 		goto err1;
 
+	dvb_frontend_activity(fe);
+
 	if ((file->f_flags & O_ACCMODE) != O_RDONLY) {
 		/* normal tune mode when opened R/W */
 		fepriv->tune_mode_flags &= ~FE_TUNE_MODE_ONESHOT;
@@ -2046,6 +2639,9 @@ static int dvb_frontend_release(struct inode *inode, struct file *file)
 
 	ret = dvb_generic_release (inode, file);
 
+	/* an idle thread must notice dvb_shutdown_timeout */
+	dvb_frontend_activity(fe);
+
 	if (dvbdev->users == -1) {
 		if (fepriv->exit != DVB_FE_NO_EXIT) {
 			fops_put(file->f_op);
@@ -2059,6 +2655,72 @@ static int dvb_frontend_release(struct inode *inode, struct file *file)
 	return ret;
 }
 
+static int dvb_frontend_debugfs_show(struct seq_file *m, void *v)
+{
+	struct dvb_frontend *fe = m->private;
+	struct dvb_frontend_private *fepriv = fe->frontend_priv;
+	struct dvb_fe_events *events = &fepriv->events;
+	u64 avg = fepriv->lock_ms_total;
+	int i, n;
+
+	if (fepriv->locks)
+		do_div(avg, fepriv->locks);
+
+	seq_printf(m, "retunes:         %u\n", fepriv->retunes);
+	seq_printf(m, "locks:           %u\n", fepriv->locks);
+	seq_printf(m, "lock losses:     %u\n", fepriv->lock_losses);
+	seq_printf(m, "event overflows: %u\n", fepriv->event_overflows);
+	seq_printf(m, "idle:            %s (entered %u times)\n",
+		   fepriv->idle ? "yes" : "no", fepriv->idle_entries);
+	seq_printf(m, "lock latency ms: min %u avg %llu max %u\n",
+		   fepriv->lock_ms_min, (unsigned long long)avg,
+		   fepriv->lock_ms_max);
+
+	seq_printf(m, "lock latency histogram:\n");
+	for (i = 0; i < DVB_FE_LOCK_HIST_BUCKETS - 1; i++)
+		seq_printf(m, "  < %6u ms: %u\n",
+			   DVB_FE_LOCK_HIST_BASE_MS << i, fepriv->lock_hist[i]);
+	seq_printf(m, "  >=%6u ms: %u\n",
+		   DVB_FE_LOCK_HIST_BASE_MS << (DVB_FE_LOCK_HIST_BUCKETS - 2),
+		   fepriv->lock_hist[DVB_FE_LOCK_HIST_BUCKETS - 1]);
+
+	if (mutex_lock_interruptible(&events->mtx))
+		return -ERESTARTSYS;
+
+	seq_printf(m, "events (oldest first):\n");
+	for (n = 0; n < events->size; n++) {
+		struct timespec ts;
+
+		i = (events->eventw + n) % events->size;
+		if (!ktime_to_ns(events->timestamps[i]))
+			continue;
+
+		ts = ktime_to_timespec(events->timestamps[i]);
+		seq_printf(m, "  %5lu.%06lu status 0x%02x%s\n",
+			   (unsigned long)ts.tv_sec, ts.tv_nsec / NSEC_PER_USEC,
+			   events->events[i].status,
+			   i == events->eventr && events->eventr != events->eventw ?
+			   " <- next FE_GET_EVENT" : "");
+	}
+
+	mutex_unlock(&events->mtx);
+
+	return 0;
+}
+
+static int dvb_frontend_debugfs_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, dvb_frontend_debugfs_show, inode->i_private);
+}
+
+static const struct file_operations dvb_frontend_debugfs_fops = {
+	.owner		= THIS_MODULE,
+	.open		= dvb_frontend_debugfs_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 static const struct file_operations dvb_frontend_fops = {
 	.owner		= THIS_MODULE,
 	.unlocked_ioctl	= dvb_generic_ioctl,
@@ -2092,12 +2754,28 @@ int dvb_register_frontend(struct dvb_adapter* dvb,
 	}
 	fepriv = fe->frontend_priv;
 
+	fepriv->events.size = clamp(dvb_event_queue_len, 2, DVB_FE_MAX_EVENT_QUEUE);
+	fepriv->events.events = kcalloc(fepriv->events.size,
+					sizeof(struct dvb_frontend_event),
+					GFP_KERNEL);
+	fepriv->events.timestamps = kcalloc(fepriv->events.size,
+					    sizeof(ktime_t), GFP_KERNEL);
+	if (!fepriv->events.events || !fepriv->events.timestamps) {
+		kfree(fepriv->events.events);
+		kfree(fepriv->events.timestamps);
+		kfree(fepriv);
+		fe->frontend_priv = NULL;
+		mutex_unlock(&frontend_mutex);
+		return -ENOMEM;
+	}
+
 	sema_init(&fepriv->sem, 1);
 	init_waitqueue_head (&fepriv->wait_queue);
 	init_waitqueue_head (&fepriv->events.wait_queue);
 	mutex_init(&fepriv->events.mtx);
 	fe->dvb = dvb;
 	fepriv->inversion = INVERSION_OFF;
+	dvb_frontend_clear_stats(fe);
 
 	printk ("DVB: registering adapter %i frontend %i (%s)...\n",
 		fe->dvb->num,
@@ -2107,6 +2785,15 @@ int dvb_register_frontend(struct dvb_adapter* dvb,
 	dvb_register_device (fe->dvb, &fepriv->dvbdev, &dvbdev_template,
 			     fe, DVB_DEVICE_FRONTEND);
 
+	if (fe->dvb->debugfs_dir && fepriv->dvbdev) {
+		char name[16];
+
+		snprintf(name, sizeof(name), "frontend%d", fepriv->dvbdev->id);
+		fepriv->debugfs = debugfs_create_file(name, 0444,
+						      fe->dvb->debugfs_dir, fe,
+						      &dvb_frontend_debugfs_fops);
+	}
+
 	mutex_unlock(&frontend_mutex);
 	return 0;
 }
@@ -2126,9 +2813,13 @@ int dvb_unregister_frontend(struct dvb_frontend* fe)
 				fepriv->dvbdev->users==-1);
 
 	mutex_lock(&frontend_mutex);
+	if (!IS_ERR_OR_NULL(fepriv->debugfs))
+		debugfs_remove(fepriv->debugfs);
 	dvb_unregister_device (fepriv->dvbdev);
 
 	/* fe is invalid now */
+	kfree(fepriv->events.events);
+	kfree(fepriv->events.timestamps);
 	kfree(fepriv);
 	mutex_unlock(&frontend_mutex);
 	return 0;
@@ -2140,6 +2831,7 @@ void dvb_frontend_detach(struct dvb_frontend* fe)
 {
 	void *ptr;
 
+	dvb_frontend_drop_hooks(fe);
 	if (fe->ops.release_sec) {
 		fe->ops.release_sec(fe);
 		symbol_put_addr(fe->ops.release_sec);
@@ -2161,6 +2853,7 @@ void dvb_frontend_detach(struct dvb_frontend* fe)
 #else
 void dvb_frontend_detach(struct dvb_frontend* fe)
 {
+	dvb_frontend_drop_hooks(fe);
 	if (fe->ops.release_sec)
 		fe->ops.release_sec(fe);
 	if (fe->ops.tuner_ops.release)
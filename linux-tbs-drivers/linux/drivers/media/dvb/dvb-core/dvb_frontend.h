@@ -37,6 +37,7 @@
 #include <linux/delay.h>
 #include <linux/mutex.h>
 #include <linux/slab.h>
+#include <linux/ktime.h>
 
 #include <linux/dvb/frontend.h>
 
@@ -189,6 +190,16 @@ enum dvbfe_search {
 };
 
 
+/*
+ * Tuning parameters which changed since the frontend last locked, as
+ * passed to the partial_tune callback.
+ *
+ * DVBFE_CHANGED_STREAM_ID
+ * Only the stream (DVB-T2 PLP / DVB-S2 MIS) selection differs
+ */
+#define DVBFE_CHANGED_STREAM_ID		(1 <<  0)
+#define DVBFE_CHANGED_OTHER		(1 << 31)
+
 struct dvb_tuner_ops {
 
 	struct dvb_tuner_info info;
@@ -306,10 +317,13 @@ struct dvb_frontend_ops {
 	int (*get_property)(struct dvb_frontend* fe, struct dtv_property* tvp);
 };
 
+/* default depth of the event queue, see the dvb_event_queue_len option */
 #define MAX_EVENT 8
 
 struct dvb_fe_events {
-	struct dvb_frontend_event events[MAX_EVENT];
+	struct dvb_frontend_event *events;
+	ktime_t			  *timestamps;	/* CLOCK_MONOTONIC, per event */
+	int			  size;
 	int			  eventw;
 	int			  eventr;
 	int			  overflow;
@@ -386,6 +400,15 @@ extern void dvb_frontend_detach(struct dvb_frontend *fe);
 
 extern void dvb_frontend_reinitialise(struct dvb_frontend *fe);
 
+/* Optional partial_tune hook: apply the DVBFE_CHANGED_* subset of
+ * dtv_property_cache while the frontend stays locked to the same
+ * multiplex. A negative return makes the core fall back to a full
+ * retune. Kept outside dvb_frontend_ops so the ops layout is unchanged;
+ * dvb_frontend_detach() drops it.
+ */
+extern int dvb_frontend_set_partial_tune(struct dvb_frontend *fe,
+	int (*partial_tune)(struct dvb_frontend *fe, unsigned int changed));
+
 extern void dvb_frontend_sleep_until(struct timeval *waketime, u32 add_usec);
 extern s32 timeval_usec_diff(struct timeval lasttime, struct timeval curtime);
 
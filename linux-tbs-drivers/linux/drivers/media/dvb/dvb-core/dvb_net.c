@@ -64,6 +64,13 @@
 #include <linux/crc32.h>
 #include <linux/mutex.h>
 #include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/log2.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/hash.h>
+#include <linux/rcupdate.h>
+#include <asm/unaligned.h>
 
 #include "dvb_demux.h"
 #include "dvb_net.h"
@@ -74,6 +81,15 @@ MODULE_PARM_DESC(dvb_net_debug, "enable debug messages");
 
 #define dprintk(x...) do { if (dvb_net_debug) printk(x); } while (0)
 
+static unsigned int dvb_net_rx_ring = 1024;
+module_param(dvb_net_rx_ring, uint, 0444);
+MODULE_PARM_DESC(dvb_net_rx_ring, "number of sections/TS chunks queued per interface "
+		 "between the demux callback and the NAPI poll (rounded to a power of 2, default 1024)");
+
+static int dvb_net_napi_weight = 64;
+module_param(dvb_net_napi_weight, int, 0444);
+MODULE_PARM_DESC(dvb_net_napi_weight, "NAPI poll budget per interface (default 64)");
+
 
 static inline __u32 iov_crc32( __u32 c, struct kvec *iov, unsigned int cnt )
 {
@@ -84,7 +100,41 @@ static inline __u32 iov_crc32( __u32 c, struct kvec *iov, unsigned int cnt )
 }
 
 
-#define DVB_NET_MULTICAST_MAX 10
+/*
+ * Multicast reception uses a single section filter on the MPE PID and
+ * checks the destination MAC of every datagram against an open
+ * addressing hash set built from the interface's multicast list. The
+ * set is replaced as a whole under RCU when the list changes.
+ */
+struct dvb_net_mc_set {
+	unsigned int bits;			/* log2 of the number of slots */
+	unsigned int count;			/* addresses in the set */
+	u8 addr[0][ETH_ALEN];			/* empty slots are all zero */
+};
+
+/*
+ * Received sections (MPE) or TS cells (ULE) are copied by the demux
+ * callback into chunks of DVB_NET_RX_CHUNK bytes and handed to the NAPI
+ * poll through a ring of descriptors. Each descriptor holds a reference
+ * on the chunk page it points into.
+ */
+#define DVB_NET_RX_CHUNK_ORDER	2
+#define DVB_NET_RX_CHUNK	(PAGE_SIZE << DVB_NET_RX_CHUNK_ORDER)
+
+/*
+ * MPE datagrams up to DVB_NET_RX_COPYBREAK bytes are copied into the skb.
+ * For larger ones only the first DVB_NET_RX_HDR_LEN bytes are copied,
+ * so the IP and transport headers sit in the linear area, and the rest
+ * of each section is referenced from the chunk page.
+ */
+#define DVB_NET_RX_COPYBREAK	256
+#define DVB_NET_RX_HDR_LEN	128
+
+struct dvb_net_rx_desc {
+	struct page *page;
+	unsigned int offset;
+	unsigned int len;
+};
 
 #undef ULE_DEBUG
 
@@ -133,14 +183,19 @@ struct dvb_net_priv {
 	struct dmx_section_feed *secfeed;
 	struct dmx_section_filter *secfilter;
 	struct dmx_ts_feed *tsfeed;
-	int multi_num;
-	struct dmx_section_filter *multi_secfilter[DVB_NET_MULTICAST_MAX];
-	unsigned char multi_macs[DVB_NET_MULTICAST_MAX][6];
+	struct dvb_net_mc_set *mc_set;		/* RCU, for RX_MODE_MULTI */
+	unsigned long mac_filtered;		/* datagrams dropped by MAC */
 	int rx_mode;
 #define RX_MODE_UNI 0
 #define RX_MODE_MULTI 1
 #define RX_MODE_ALL_MULTI 2
 #define RX_MODE_PROMISC 3
+	struct sk_buff *mpe_skb;		/* MPE datagram being reassembled */
+	unsigned char mpe_mac[ETH_ALEN];	/* its destination MAC */
+	u8 mpe_next_section;			/* expected section_number */
+	u8 mpe_last_section;			/* its last_section_number */
+	unsigned long mpe_reassembled;		/* multi-section datagrams received */
+	unsigned long mpe_incomplete;		/* partial datagrams dropped */
 	struct work_struct set_multicast_list_wq;
 	struct work_struct restart_net_feed_wq;
 	unsigned char feedtype;			/* Either FEED_TYPE_ or FEED_TYPE_ULE */
@@ -157,6 +212,25 @@ struct dvb_net_priv {
 	int ule_sndu_remain;			/* Nr. of bytes still required for current ULE SNDU. */
 	unsigned long ts_count;			/* Current ts cell counter. */
 	struct mutex mutex;
+
+	/* NAPI receive path */
+	struct napi_struct napi;
+	int napi_enabled;
+	struct dvb_net_rx_desc *rx_ring;	/* written by the demux callback */
+	unsigned int rx_ring_mask;
+	unsigned int rx_head;			/* producer index (demux callback) */
+	unsigned int rx_tail;			/* consumer index (NAPI poll) */
+	struct page *rx_page;			/* chunk currently being filled */
+	unsigned int rx_page_offset;
+	struct dentry *debugfs;
+
+	/* NAPI statistics, see dvb_net_debugfs_show() */
+	unsigned long napi_polls;
+	unsigned long napi_work;		/* ring entries handled */
+	unsigned long napi_budget_exhausted;	/* polls that used the full budget */
+	unsigned int napi_max_batch;
+	unsigned long rx_ring_full;		/* entries dropped, ring full */
+	unsigned long rx_alloc_failed;		/* entries dropped, no chunk page */
 };
 
 
@@ -339,6 +413,82 @@ static inline void reset_ule( struct dvb_net_priv *p )
 	p->ule_bridged = 0;
 }
 
+static inline unsigned int dvb_net_mc_hash(const struct dvb_net_mc_set *set,
+					   const u8 *addr)
+{
+	/* IPv4 and IPv6 group MACs only differ in the low four bytes */
+	return hash_32(get_unaligned((u32 *)(addr + 2)), set->bits);
+}
+
+static struct dvb_net_mc_set *dvb_net_mc_set_alloc(unsigned int count, gfp_t gfp)
+{
+	struct dvb_net_mc_set *set;
+	unsigned int bits = ilog2(roundup_pow_of_two(max(2 * count, 16U)));
+
+	set = kzalloc(sizeof(*set) + (ETH_ALEN << bits), gfp);
+	if (set)
+		set->bits = bits;
+	return set;
+}
+
+static void dvb_net_mc_set_add(struct dvb_net_mc_set *set, const u8 *addr)
+{
+	unsigned int mask = (1U << set->bits) - 1;
+	unsigned int i = dvb_net_mc_hash(set, addr);
+
+	/* the set is at most half full, so there is always an empty slot */
+	if (2 * (set->count + 1) > mask + 1 || is_zero_ether_addr(addr))
+		return;
+	while (!is_zero_ether_addr(set->addr[i])) {
+		if (!memcmp(set->addr[i], addr, ETH_ALEN))
+			return;
+		i = (i + 1) & mask;
+	}
+	memcpy(set->addr[i], addr, ETH_ALEN);
+	set->count++;
+}
+
+static int dvb_net_mc_set_lookup(const struct dvb_net_mc_set *set, const u8 *addr)
+{
+	unsigned int mask = (1U << set->bits) - 1;
+	unsigned int i = dvb_net_mc_hash(set, addr);
+
+	while (!is_zero_ether_addr(set->addr[i])) {
+		if (!memcmp(set->addr[i], addr, ETH_ALEN))
+			return 1;
+		i = (i + 1) & mask;
+	}
+	return 0;
+}
+
+/**
+ *	Decide from the destination MAC whether a received datagram is
+ *	passed up the stack. Broadcasts are always accepted; in
+ *	RX_MODE_UNI the MPE section filter has already matched our address.
+ */
+static int dvb_net_mac_accept(struct net_device *dev, const u8 *addr)
+{
+	struct dvb_net_priv *priv = netdev_priv(dev);
+	struct dvb_net_mc_set *set;
+	int ret = 0;
+
+	if (priv->rx_mode == RX_MODE_PROMISC)
+		return 1;
+	if (!(addr[0] & 0x01))
+		return !memcmp(addr, dev->dev_addr, ETH_ALEN);
+	if (is_broadcast_ether_addr(addr) || priv->rx_mode == RX_MODE_ALL_MULTI)
+		return 1;
+	if (priv->rx_mode != RX_MODE_MULTI)
+		return 0;
+
+	rcu_read_lock();
+	set = rcu_dereference(priv->mc_set);
+	if (set)
+		ret = dvb_net_mc_set_lookup(set, addr);
+	rcu_read_unlock();
+	return ret;
+}
+
 /**
  * Decode ULE SNDUs according to draft-ietf-ipdvb-ule-03.txt from a sequence of
  * TS cells of a single PID.
@@ -654,8 +804,6 @@ static void dvb_net_ule( struct net_device *dev, const u8 *buf, size_t buf_len )
 			} else {
 				/* CRC32 verified OK. */
 				u8 dest_addr[ETH_ALEN];
-				static const u8 bc_addr[ETH_ALEN] =
-					{ [ 0 ... ETH_ALEN-1] = 0xff };
 
 				/* CRC32 was OK. Remove it from skb. */
 				priv->ule_skb->tail -= 4;
@@ -670,35 +818,14 @@ static void dvb_net_ule( struct net_device *dev, const u8 *buf, size_t buf_len )
 					 * Check if the payload of this SNDU
 					 * should be passed up the stack.
 					 */
-					register int drop = 0;
-					if (priv->rx_mode != RX_MODE_PROMISC) {
-						if (priv->ule_skb->data[0] & 0x01) {
-							/* multicast or broadcast */
-							if (memcmp(priv->ule_skb->data, bc_addr, ETH_ALEN)) {
-								/* multicast */
-								if (priv->rx_mode == RX_MODE_MULTI) {
-									int i;
-									for(i = 0; i < priv->multi_num && memcmp(priv->ule_skb->data, priv->multi_macs[i], ETH_ALEN); i++)
-										;
-									if (i == priv->multi_num)
-										drop = 1;
-								} else if (priv->rx_mode != RX_MODE_ALL_MULTI)
-									drop = 1; /* no broadcast; */
-								/* else: all multicast mode: accept all multicast packets */
-							}
-							/* else: broadcast */
-						}
-						else if (memcmp(priv->ule_skb->data, dev->dev_addr, ETH_ALEN))
-							drop = 1;
-						/* else: destination address matches the MAC address of our receiver device */
-					}
-					/* else: promiscuous mode; pass everything up the stack */
+					register int drop = !dvb_net_mac_accept(dev, priv->ule_skb->data);
 
 					if (drop) {
 #ifdef ULE_DEBUG
 						dprintk("Dropping SNDU: MAC destination address does not match: dest addr: "MAC_ADDR_PRINTFMT", dev addr: "MAC_ADDR_PRINTFMT"\n",
 							MAX_ADDR_PRINTFMT_ARGS(priv->ule_skb->data), MAX_ADDR_PRINTFMT_ARGS(dev->dev_addr));
 #endif
+						priv->mac_filtered++;
 						dev_kfree_skb(priv->ule_skb);
 						goto sndu_done;
 					}
@@ -757,7 +884,7 @@ static void dvb_net_ule( struct net_device *dev, const u8 *buf, size_t buf_len )
 					priv->ule_skb->pkt_type = PACKET_HOST; */
 				dev->stats.rx_packets++;
 				dev->stats.rx_bytes += priv->ule_skb->len;
-				netif_rx(priv->ule_skb);
+				napi_gro_receive(&priv->napi, priv->ule_skb);
 			}
 			sndu_done:
 			/* Prepare for next SNDU. */
@@ -789,6 +916,56 @@ static void dvb_net_ule( struct net_device *dev, const u8 *buf, size_t buf_len )
 	}	/* for all available TS cells */
 }
 
+/**
+ *	Called from the demux callback with the demux lock held, usually in
+ *	IRQ or tasklet context: copy the data into the current chunk page and
+ *	hand it to the NAPI poll. No skb is allocated here.
+ */
+static void dvb_net_rx_queue(struct net_device *dev, const u8 *buf, size_t len)
+{
+	struct dvb_net_priv *priv = netdev_priv(dev);
+	struct dvb_net_rx_desc *desc;
+	unsigned int head = priv->rx_head;
+
+	if (!priv->napi_enabled || !len || len > DVB_NET_RX_CHUNK)
+		return;
+
+	if (head - ACCESS_ONCE(priv->rx_tail) > priv->rx_ring_mask) {
+		priv->rx_ring_full++;
+		dev->stats.rx_dropped++;
+		dev->stats.rx_fifo_errors++;
+		goto out;
+	}
+
+	if (!priv->rx_page || priv->rx_page_offset + len > DVB_NET_RX_CHUNK) {
+		if (priv->rx_page)
+			put_page(priv->rx_page);
+		priv->rx_page = alloc_pages(GFP_ATOMIC | __GFP_COMP | __GFP_NOWARN,
+					    DVB_NET_RX_CHUNK_ORDER);
+		priv->rx_page_offset = 0;
+		if (!priv->rx_page) {
+			priv->rx_alloc_failed++;
+			dev->stats.rx_dropped++;
+			goto out;
+		}
+	}
+
+	memcpy(page_address(priv->rx_page) + priv->rx_page_offset, buf, len);
+
+	desc = &priv->rx_ring[head & priv->rx_ring_mask];
+	get_page(priv->rx_page);
+	desc->page = priv->rx_page;
+	desc->offset = priv->rx_page_offset;
+	desc->len = len;
+	priv->rx_page_offset += ALIGN(len, L1_CACHE_BYTES);
+
+	/* publish the descriptor before the new head */
+	smp_wmb();
+	priv->rx_head = head + 1;
+out:
+	napi_schedule(&priv->napi);
+}
+
 static int dvb_net_ts_callback(const u8 *buffer1, size_t buffer1_len,
 			       const u8 *buffer2, size_t buffer2_len,
 			       struct dmx_ts_feed *feed, enum dmx_success success)
@@ -801,18 +978,78 @@ static int dvb_net_ts_callback(const u8 *buffer1, size_t buffer1_len,
 		printk(KERN_WARNING "length > 32k: %zu.\n", buffer1_len);
 	/* printk("TS callback: %u bytes, %u TS cells @ %p.\n",
 		  buffer1_len, buffer1_len / TS_SZ, buffer1); */
-	dvb_net_ule(dev, buffer1, buffer1_len);
+	while (buffer1_len) {
+		size_t len = min_t(size_t, buffer1_len,
+				   rounddown(DVB_NET_RX_CHUNK, TS_SZ));
+
+		dvb_net_rx_queue(dev, buffer1, len);
+		buffer1 += len;
+		buffer1_len -= len;
+	}
 	return 0;
 }
 
 
-static void dvb_net_sec(struct net_device *dev,
-			const u8 *pkt, int pkt_len)
+/*
+ * Add @len bytes at @offset in a receive chunk page to @skb: small pieces
+ * are copied into the linear area, larger ones are attached as a page
+ * fragment holding its own reference on the chunk.
+ */
+static int dvb_net_skb_add_data(struct sk_buff *skb, struct page *page,
+				unsigned int offset, unsigned int len)
 {
+	if (!len)
+		return 0;
+	if (!skb_shinfo(skb)->nr_frags && len <= skb_tailroom(skb)) {
+		memcpy(skb_put(skb, len), page_address(page) + offset, len);
+		return 0;
+	}
+	if (skb_shinfo(skb)->nr_frags >= MAX_SKB_FRAGS)
+		return -ENOSPC;
+
+	get_page(page);
+#if LINUX_VERSION_CODE < KERNEL_VERSION(3, 4, 0)
+	skb_add_rx_frag(skb, skb_shinfo(skb)->nr_frags, page, offset, len);
+#else
+	skb_add_rx_frag(skb, skb_shinfo(skb)->nr_frags, page, offset, len,
+			ALIGN(len, L1_CACHE_BYTES));
+#endif
+	return 0;
+}
+
+static void dvb_net_mpe_drop(struct net_device *dev)
+{
+	struct dvb_net_priv *priv = netdev_priv(dev);
+
+	if (!priv->mpe_skb)
+		return;
+	dev_kfree_skb(priv->mpe_skb);
+	priv->mpe_skb = NULL;
+	priv->mpe_incomplete++;
+	dev->stats.rx_errors++;
+	dev->stats.rx_frame_errors++;
+}
+
+/**
+ *	Handle one MPE section (EN 301 192, 7.1) sitting in a receive chunk.
+ *	A datagram may span sections 0..last_section_number, all carrying
+ *	the same MAC address; the payloads are chained onto priv->mpe_skb
+ *	until the last section arrives. Only the Ethernet header and the
+ *	start of the datagram are copied, the rest of the payload is
+ *	attached to the skb as page fragments.
+ */
+static void dvb_net_sec(struct net_device *dev, struct page *page,
+			unsigned int offset, int pkt_len)
+{
+	struct dvb_net_priv *priv = netdev_priv(dev);
+	const u8 *pkt = page_address(page) + offset;
 	u8 *eth;
+	u8 dest[ETH_ALEN];
 	struct sk_buff *skb;
 	struct net_device_stats *stats = &dev->stats;
 	int snap = 0;
+	u8 section_number, last_section_number;
+	unsigned int data_len, copy;
 
 	/* note: pkt_len includes a 32bit checksum */
 	if (pkt_len < 16) {
@@ -835,6 +1072,46 @@ static void dvb_net_sec(struct net_device *dev,
 		stats->rx_crc_errors++;
 		return;
 	}
+
+	dest[0] = pkt[0x0b];
+	dest[1] = pkt[0x0a];
+	dest[2] = pkt[0x09];
+	dest[3] = pkt[0x08];
+	dest[4] = pkt[0x04];
+	dest[5] = pkt[0x03];
+	if (!dvb_net_mac_accept(dev, dest)) {
+		priv->mac_filtered++;
+		return;
+	}
+
+	section_number = pkt[6];
+	last_section_number = pkt[7];
+
+	if (section_number) {
+		/* continuation of the datagram in priv->mpe_skb */
+		if (!priv->mpe_skb || section_number != priv->mpe_next_section ||
+		    last_section_number != priv->mpe_last_section ||
+		    memcmp(dest, priv->mpe_mac, ETH_ALEN)) {
+			if (priv->mpe_skb)
+				dvb_net_mpe_drop(dev);
+			else {
+				/* first section lost */
+				stats->rx_errors++;
+				stats->rx_frame_errors++;
+			}
+			return;
+		}
+		skb = priv->mpe_skb;
+		if (dvb_net_skb_add_data(skb, page, offset + 12, pkt_len - 12 - 4)) {
+			dvb_net_mpe_drop(dev);
+			return;
+		}
+		goto section_done;
+	}
+
+	/* a new datagram starts, the previous one can no longer complete */
+	dvb_net_mpe_drop(dev);
+
 	if (pkt[5] & 0x02) {
 		/* handle LLC/SNAP, see rfc-1042 */
 		if (pkt_len < 24 || memcmp(&pkt[12], "\xaa\xaa\x03\0\0\0", 6)) {
@@ -843,17 +1120,16 @@ static void dvb_net_sec(struct net_device *dev,
 		}
 		snap = 8;
 	}
-	if (pkt[7]) {
-		/* FIXME: assemble datagram from multiple sections */
-		stats->rx_errors++;
-		stats->rx_frame_errors++;
-		return;
-	}
 
 	/* we have 14 byte ethernet header (ip header follows);
 	 * 12 byte MPE header; 4 byte checksum; + 2 byte alignment, 8 byte LLC/SNAP
 	 */
-	if (!(skb = dev_alloc_skb(pkt_len - 4 - 12 + 14 + 2 - snap))) {
+	data_len = pkt_len - 12 - 4 - snap;
+	copy = data_len <= DVB_NET_RX_COPYBREAK ? data_len : DVB_NET_RX_HDR_LEN;
+	if (last_section_number)
+		copy = min_t(unsigned int, data_len, DVB_NET_RX_HDR_LEN);
+
+	if (!(skb = netdev_alloc_skb(dev, copy + 14 + 2))) {
 		//printk(KERN_NOTICE "%s: Memory squeeze, dropping packet.\n", dev->name);
 		stats->rx_dropped++;
 		return;
@@ -861,17 +1137,18 @@ static void dvb_net_sec(struct net_device *dev,
 	skb_reserve(skb, 2);    /* longword align L3 header */
 	skb->dev = dev;
 
-	/* copy L3 payload */
-	eth = (u8 *) skb_put(skb, pkt_len - 12 - 4 + 14 - snap);
-	memcpy(eth + 14, pkt + 12 + snap, pkt_len - 12 - 4 - snap);
+	/* copy the start of the L3 payload, the remainder goes into frags */
+	eth = (u8 *) skb_put(skb, 14 + copy);
+	memcpy(eth + 14, pkt + 12 + snap, copy);
+	if (dvb_net_skb_add_data(skb, page, offset + 12 + snap + copy,
+				 data_len - copy)) {
+		dev_kfree_skb(skb);
+		stats->rx_dropped++;
+		return;
+	}
 
 	/* create ethernet header: */
-	eth[0]=pkt[0x0b];
-	eth[1]=pkt[0x0a];
-	eth[2]=pkt[0x09];
-	eth[3]=pkt[0x08];
-	eth[4]=pkt[0x04];
-	eth[5]=pkt[0x03];
+	memcpy(eth, dest, ETH_ALEN);
 
 	eth[6]=eth[7]=eth[8]=eth[9]=eth[10]=eth[11]=0;
 
@@ -891,11 +1168,27 @@ static void dvb_net_sec(struct net_device *dev,
 		}
 	}
 
+	if (last_section_number) {
+		priv->mpe_skb = skb;
+		priv->mpe_last_section = last_section_number;
+		memcpy(priv->mpe_mac, dest, ETH_ALEN);
+	}
+
+section_done:
+	if (section_number != last_section_number) {
+		priv->mpe_next_section = section_number + 1;
+		return;
+	}
+	if (last_section_number) {
+		priv->mpe_skb = NULL;
+		priv->mpe_reassembled++;
+	}
+
 	skb->protocol = dvb_net_eth_type_trans(skb, dev);
 
 	stats->rx_packets++;
 	stats->rx_bytes+=skb->len;
-	netif_rx(skb);
+	napi_gro_receive(&priv->napi, skb);
 }
 
 static int dvb_net_sec_callback(const u8 *buffer1, size_t buffer1_len,
@@ -909,10 +1202,105 @@ static int dvb_net_sec_callback(const u8 *buffer1, size_t buffer1_len,
 	 * we rely on the DVB API definition where exactly one complete
 	 * section is delivered in buffer1
 	 */
-	dvb_net_sec (dev, buffer1, buffer1_len);
+	dvb_net_rx_queue(dev, buffer1, buffer1_len);
 	return 0;
 }
 
+
+/**
+ *	NAPI poll: decode the queued sections or TS cells and pass the
+ *	resulting skbs up the stack. Each ring entry counts as one unit of
+ *	work, so a ULE chunk carrying several SNDUs is charged once.
+ */
+static int dvb_net_poll(struct napi_struct *napi, int budget)
+{
+	struct dvb_net_priv *priv = container_of(napi, struct dvb_net_priv, napi);
+	struct net_device *dev = priv->net;
+	struct dvb_net_rx_desc *desc;
+	unsigned int tail = priv->rx_tail;
+	int work = 0;
+
+	while (work < budget && tail != ACCESS_ONCE(priv->rx_head)) {
+		/* read the descriptor only after seeing the new head */
+		smp_rmb();
+		desc = &priv->rx_ring[tail & priv->rx_ring_mask];
+
+		if (priv->feedtype == DVB_NET_FEEDTYPE_ULE)
+			dvb_net_ule(dev, page_address(desc->page) + desc->offset,
+				    desc->len);
+		else
+			dvb_net_sec(dev, desc->page, desc->offset, desc->len);
+
+		put_page(desc->page);
+		desc->page = NULL;
+		tail++;
+		work++;
+		/* the slot may be reused once the new tail is visible */
+		smp_mb();
+		priv->rx_tail = tail;
+	}
+
+	priv->napi_polls++;
+	priv->napi_work += work;
+	if (work > priv->napi_max_batch)
+		priv->napi_max_batch = work;
+
+	if (work < budget) {
+		napi_complete(napi);
+		/* the demux callback may have queued more after our last check */
+		if (tail != ACCESS_ONCE(priv->rx_head))
+			napi_schedule(napi);
+	} else
+		priv->napi_budget_exhausted++;
+
+	return work;
+}
+
+static void dvb_net_rx_start(struct net_device *dev)
+{
+	struct dvb_net_priv *priv = netdev_priv(dev);
+
+	if (priv->napi_enabled)
+		return;
+	napi_enable(&priv->napi);
+	priv->napi_enabled = 1;
+}
+
+/* Must be called with the feeds stopped, i.e. with no producer running. */
+static void dvb_net_rx_stop(struct net_device *dev)
+{
+	struct dvb_net_priv *priv = netdev_priv(dev);
+	struct dvb_net_rx_desc *desc;
+
+	if (!priv->napi_enabled)
+		return;
+	priv->napi_enabled = 0;
+	napi_disable(&priv->napi);
+
+	while (priv->rx_tail != priv->rx_head) {
+		desc = &priv->rx_ring[priv->rx_tail & priv->rx_ring_mask];
+		put_page(desc->page);
+		desc->page = NULL;
+		priv->rx_tail++;
+	}
+	if (priv->rx_page) {
+		put_page(priv->rx_page);
+		priv->rx_page = NULL;
+	}
+
+	/* drop a partially reassembled MPE datagram or ULE SNDU */
+	if (priv->mpe_skb) {
+		dev_kfree_skb(priv->mpe_skb);
+		priv->mpe_skb = NULL;
+	}
+	if (priv->ule_skb) {
+		dev_kfree_skb(priv->ule_skb);
+		priv->ule_skb = NULL;
+	}
+	reset_ule(priv);
+	priv->need_pusi = 1;
+}
+
 static int dvb_net_tx(struct sk_buff *skb, struct net_device *dev)
 {
 	dev_kfree_skb(skb);
@@ -920,8 +1308,6 @@ static int dvb_net_tx(struct sk_buff *skb, struct net_device *dev)
 }
 
 static u8 mask_normal[6]={0xff, 0xff, 0xff, 0xff, 0xff, 0xff};
-static u8 mask_allmulti[6]={0xff, 0xff, 0xff, 0x00, 0x00, 0x00};
-static u8 mac_allmulti[6]={0x01, 0x00, 0x5e, 0x00, 0x00, 0x00};
 static u8 mask_promisc[6]={0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
 
 static int dvb_net_filter_sec_set(struct net_device *dev,
@@ -968,14 +1354,14 @@ static int dvb_net_filter_sec_set(struct net_device *dev,
 
 static int dvb_net_feed_start(struct net_device *dev)
 {
-	int ret = 0, i;
+	int ret = 0;
 	struct dvb_net_priv *priv = netdev_priv(dev);
 	struct dmx_demux *demux = priv->demux;
 	unsigned char *mac = (unsigned char *) dev->dev_addr;
 
 	dprintk("%s: rx_mode %i\n", __func__, priv->rx_mode);
 	mutex_lock(&priv->mutex);
-	if (priv->tsfeed || priv->secfeed || priv->secfilter || priv->multi_secfilter[0])
+	if (priv->tsfeed || priv->secfeed || priv->secfilter)
 		printk("%s: BUG %d\n", __func__, __LINE__);
 
 	priv->secfeed=NULL;
@@ -1000,31 +1386,16 @@ static int dvb_net_feed_start(struct net_device *dev)
 			goto error;
 		}
 
-		if (priv->rx_mode != RX_MODE_PROMISC) {
-			dprintk("%s: set secfilter\n", __func__);
+		/*
+		 * Unicast only: let the demux match our MAC. Otherwise one
+		 * filter passes every MPE section on the PID and
+		 * dvb_net_mac_accept() picks the datagrams.
+		 */
+		dprintk("%s: set secfilter\n", __func__);
+		if (priv->rx_mode == RX_MODE_UNI)
 			dvb_net_filter_sec_set(dev, &priv->secfilter, mac, mask_normal);
-		}
-
-		switch (priv->rx_mode) {
-		case RX_MODE_MULTI:
-			for (i = 0; i < priv->multi_num; i++) {
-				dprintk("%s: set multi_secfilter[%d]\n", __func__, i);
-				dvb_net_filter_sec_set(dev, &priv->multi_secfilter[i],
-						       priv->multi_macs[i], mask_normal);
-			}
-			break;
-		case RX_MODE_ALL_MULTI:
-			priv->multi_num=1;
-			dprintk("%s: set multi_secfilter[0]\n", __func__);
-			dvb_net_filter_sec_set(dev, &priv->multi_secfilter[0],
-					       mac_allmulti, mask_allmulti);
-			break;
-		case RX_MODE_PROMISC:
-			priv->multi_num=0;
-			dprintk("%s: set secfilter\n", __func__);
+		else
 			dvb_net_filter_sec_set(dev, &priv->secfilter, mac, mask_promisc);
-			break;
-		}
 
 		dprintk("%s: start filtering\n", __func__);
 		priv->secfeed->start_filtering(priv->secfeed);
@@ -1069,7 +1440,7 @@ error:
 static int dvb_net_feed_stop(struct net_device *dev)
 {
 	struct dvb_net_priv *priv = netdev_priv(dev);
-	int i, ret = 0;
+	int ret = 0;
 
 	dprintk("%s\n", __func__);
 	mutex_lock(&priv->mutex);
@@ -1087,16 +1458,6 @@ static int dvb_net_feed_stop(struct net_device *dev)
 				priv->secfilter=NULL;
 			}
 
-			for (i=0; i<priv->multi_num; i++) {
-				if (priv->multi_secfilter[i]) {
-					dprintk("%s: release multi_filter[%d]\n",
-						__func__, i);
-					priv->secfeed->release_filter(priv->secfeed,
-								      priv->multi_secfilter[i]);
-					priv->multi_secfilter[i] = NULL;
-				}
-			}
-
 			priv->demux->release_section_feed(priv->demux, priv->secfeed);
 			priv->secfeed = NULL;
 		} else
@@ -1118,44 +1479,22 @@ static int dvb_net_feed_stop(struct net_device *dev)
 	return ret;
 }
 
-#if LINUX_VERSION_CODE <= KERNEL_VERSION(2,6,34)
-static int dvb_set_mc_filter (struct net_device *dev, struct dev_mc_list *mc)
-#else
-static int dvb_set_mc_filter(struct net_device *dev, unsigned char *addr)
-#endif
-{
-	struct dvb_net_priv *priv = netdev_priv(dev);
-
-	if (priv->multi_num == DVB_NET_MULTICAST_MAX)
-		return -ENOMEM;
-
-#if LINUX_VERSION_CODE <= KERNEL_VERSION(2,6,34)
-	memcpy(priv->multi_macs[priv->multi_num], mc->dmi_addr, 6);
-#else
-	memcpy(priv->multi_macs[priv->multi_num], addr, ETH_ALEN);
-#endif
-
-	priv->multi_num++;
-	return 0;
-}
-
-
 static void wq_set_multicast_list (struct work_struct *work)
 {
 	struct dvb_net_priv *priv =
 		container_of(work, struct dvb_net_priv, set_multicast_list_wq);
 	struct net_device *dev = priv->net;
+	struct dvb_net_mc_set *set = NULL, *old;
+	int rx_mode = RX_MODE_UNI;
 
-	dvb_net_feed_stop(dev);
-	priv->rx_mode = RX_MODE_UNI;
 	netif_addr_lock_bh(dev);
 
 	if (dev->flags & IFF_PROMISC) {
 		dprintk("%s: promiscuous mode\n", dev->name);
-		priv->rx_mode = RX_MODE_PROMISC;
+		rx_mode = RX_MODE_PROMISC;
 	} else if ((dev->flags & IFF_ALLMULTI)) {
 		dprintk("%s: allmulti mode\n", dev->name);
-		priv->rx_mode = RX_MODE_ALL_MULTI;
+		rx_mode = RX_MODE_ALL_MULTI;
 	} else if (!netdev_mc_empty(dev)) {
 #if LINUX_VERSION_CODE <= KERNEL_VERSION(2,6,34)
 		struct dev_mc_list *mc;
@@ -1166,20 +1505,42 @@ static void wq_set_multicast_list (struct work_struct *work)
 		dprintk("%s: set_mc_list, %d entries\n",
 			dev->name, netdev_mc_count(dev));
 
-		priv->rx_mode = RX_MODE_MULTI;
-		priv->multi_num = 0;
-
+		rx_mode = RX_MODE_MULTI;
+		set = dvb_net_mc_set_alloc(netdev_mc_count(dev), GFP_ATOMIC);
+		if (!set) {
+			printk("%s: no memory for multicast list, "
+			       "receiving all multicast\n", dev->name);
+			rx_mode = RX_MODE_ALL_MULTI;
+		} else {
 #if LINUX_VERSION_CODE <= KERNEL_VERSION(2,6,34)
-		netdev_for_each_mc_addr(mc, dev)
-			dvb_set_mc_filter(dev, mc);
+			netdev_for_each_mc_addr(mc, dev)
+				dvb_net_mc_set_add(set, mc->dmi_addr);
 #else
-		netdev_for_each_mc_addr(ha, dev)
-			dvb_set_mc_filter(dev, ha->addr);
+			netdev_for_each_mc_addr(ha, dev)
+				dvb_net_mc_set_add(set, ha->addr);
 #endif
+		}
 	}
 
 	netif_addr_unlock_bh(dev);
-	dvb_net_feed_start(dev);
+
+	old = priv->mc_set;
+	rcu_assign_pointer(priv->mc_set, set);
+
+	/* the section filter only depends on the mode, not on the list */
+	if (rx_mode != priv->rx_mode) {
+		if (netif_running(dev)) {
+			dvb_net_feed_stop(dev);
+			priv->rx_mode = rx_mode;
+			dvb_net_feed_start(dev);
+		} else
+			priv->rx_mode = rx_mode;
+	}
+
+	if (old) {
+		synchronize_rcu();
+		kfree(old);
+	}
 }
 
 
@@ -1222,6 +1583,7 @@ static int dvb_net_open(struct net_device *dev)
 	struct dvb_net_priv *priv = netdev_priv(dev);
 
 	priv->in_use++;
+	dvb_net_rx_start(dev);
 	dvb_net_feed_start(dev);
 	return 0;
 }
@@ -1230,9 +1592,12 @@ static int dvb_net_open(struct net_device *dev)
 static int dvb_net_stop(struct net_device *dev)
 {
 	struct dvb_net_priv *priv = netdev_priv(dev);
+	int ret;
 
 	priv->in_use--;
-	return dvb_net_feed_stop(dev);
+	ret = dvb_net_feed_stop(dev);
+	dvb_net_rx_stop(dev);
+	return ret;
 }
 
 static const struct header_ops dvb_header_ops = {
@@ -1265,10 +1630,53 @@ static void dvb_net_setup(struct net_device *dev)
 	dev->header_ops		= &dvb_header_ops;
 	dev->netdev_ops		= &dvb_netdev_ops;
 	dev->mtu		= 4096;
+	dev->features		|= NETIF_F_GRO;
 
 	dev->flags |= IFF_NOARP;
 }
 
+static int dvb_net_debugfs_show(struct seq_file *m, void *v)
+{
+	struct net_device *dev = m->private;
+	struct dvb_net_priv *priv = netdev_priv(dev);
+	struct dvb_net_mc_set *set;
+
+	seq_printf(m, "feed type:             %s\n",
+		   priv->feedtype == DVB_NET_FEEDTYPE_ULE ? "ULE" : "MPE");
+	seq_printf(m, "rx mode:               %d\n", priv->rx_mode);
+	rcu_read_lock();
+	set = rcu_dereference(priv->mc_set);
+	seq_printf(m, "multicast groups:      %u\n", set ? set->count : 0);
+	rcu_read_unlock();
+	seq_printf(m, "mac filter drops:      %lu\n", priv->mac_filtered);
+	seq_printf(m, "mpe reassembled:       %lu\n", priv->mpe_reassembled);
+	seq_printf(m, "mpe incomplete:        %lu\n", priv->mpe_incomplete);
+	seq_printf(m, "napi weight:           %d\n", priv->napi.weight);
+	seq_printf(m, "napi polls:            %lu\n", priv->napi_polls);
+	seq_printf(m, "napi work:             %lu\n", priv->napi_work);
+	seq_printf(m, "napi budget exhausted: %lu\n", priv->napi_budget_exhausted);
+	seq_printf(m, "napi max batch:        %u\n", priv->napi_max_batch);
+	seq_printf(m, "rx ring size:          %u\n", priv->rx_ring_mask + 1);
+	seq_printf(m, "rx ring used:          %u\n",
+		   priv->rx_head - priv->rx_tail);
+	seq_printf(m, "rx ring full drops:    %lu\n", priv->rx_ring_full);
+	seq_printf(m, "rx alloc failures:     %lu\n", priv->rx_alloc_failed);
+	return 0;
+}
+
+static int dvb_net_debugfs_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, dvb_net_debugfs_show, inode->i_private);
+}
+
+static const struct file_operations dvb_net_debugfs_fops = {
+	.owner		= THIS_MODULE,
+	.open		= dvb_net_debugfs_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 static int get_if(struct dvb_net *dvbnet)
 {
 	int i;
@@ -1288,6 +1696,7 @@ static int dvb_net_add_if(struct dvb_net *dvbnet, u16 pid, u8 feedtype)
 {
 	struct net_device *net;
 	struct dvb_net_priv *priv;
+	unsigned int ring_size;
 	int result;
 	int if_num;
 
@@ -1332,15 +1741,33 @@ static int dvb_net_add_if(struct dvb_net *dvbnet, u16 pid, u8 feedtype)
 	INIT_WORK(&priv->restart_net_feed_wq, wq_restart_net_feed);
 	mutex_init(&priv->mutex);
 
+	ring_size = roundup_pow_of_two(clamp(dvb_net_rx_ring, 16U, 65536U));
+	priv->rx_ring = kcalloc(ring_size, sizeof(*priv->rx_ring), GFP_KERNEL);
+	if (!priv->rx_ring) {
+		dvbnet->device[if_num] = NULL;
+		free_netdev(net);
+		return -ENOMEM;
+	}
+	priv->rx_ring_mask = ring_size - 1;
+	netif_napi_add(net, &priv->napi, dvb_net_poll,
+		       clamp(dvb_net_napi_weight, 1, 256));
+
 	net->base_addr = pid;
 
 	if ((result = register_netdev(net)) < 0) {
 		dvbnet->device[if_num] = NULL;
+		netif_napi_del(&priv->napi);
+		kfree(priv->rx_ring);
 		free_netdev(net);
 		return result;
 	}
 	printk("dvb_net: created network interface %s\n", net->name);
 
+	if (dvbnet->dvbdev->adapter->debugfs_dir)
+		priv->debugfs = debugfs_create_file(net->name, 0444,
+					dvbnet->dvbdev->adapter->debugfs_dir,
+					net, &dvb_net_debugfs_fops);
+
 	return if_num;
 }
 
@@ -1359,9 +1786,14 @@ static int dvb_net_remove_if(struct dvb_net *dvbnet, unsigned long num)
 	flush_work_sync(&priv->set_multicast_list_wq);
 	flush_work_sync(&priv->restart_net_feed_wq);
 	printk("dvb_net: removed network interface %s\n", net->name);
+	if (!IS_ERR_OR_NULL(priv->debugfs))
+		debugfs_remove(priv->debugfs);
 	unregister_netdev(net);
 	dvbnet->state[num]=0;
 	dvbnet->device[num] = NULL;
+	netif_napi_del(&priv->napi);
+	kfree(priv->rx_ring);
+	kfree(priv->mc_set);
 	free_netdev(net);
 
 	return 0;
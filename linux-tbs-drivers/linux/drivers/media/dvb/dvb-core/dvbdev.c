@@ -32,6 +32,7 @@
 #include <linux/fs.h>
 #include <linux/cdev.h>
 #include <linux/mutex.h>
+#include <linux/debugfs.h>
 #include "dvbdev.h"
 
 static DEFINE_MUTEX(dvbdev_mutex);
@@ -60,6 +61,7 @@ static const char * const dnames[] = {
 #endif
 
 static struct class *dvb_class;
+static struct dentry *dvb_debugfs_root;
 
 static struct dvb_device *dvb_minors[MAX_DVB_MINORS];
 static DECLARE_RWSEM(minor_rwsem);
@@ -355,6 +357,15 @@ int dvb_register_adapter(struct dvb_adapter *adap, const char *name,
 	adap->mfe_dvbdev = NULL;
 	mutex_init (&adap->mfe_lock);
 
+	if (!IS_ERR_OR_NULL(dvb_debugfs_root)) {
+		char dirname[16];
+
+		snprintf(dirname, sizeof(dirname), "adapter%d", num);
+		adap->debugfs_dir = debugfs_create_dir(dirname, dvb_debugfs_root);
+		if (IS_ERR(adap->debugfs_dir))
+			adap->debugfs_dir = NULL;
+	}
+
 	list_add_tail (&adap->list_head, &dvb_adapter_list);
 
 	mutex_unlock(&dvbdev_register_lock);
@@ -369,6 +380,8 @@ int dvb_unregister_adapter(struct dvb_adapter *adap)
 	mutex_lock(&dvbdev_register_lock);
 	list_del (&adap->list_head);
 	mutex_unlock(&dvbdev_register_lock);
+	debugfs_remove_recursive(adap->debugfs_dir);
+	adap->debugfs_dir = NULL;
 	return 0;
 }
 EXPORT_SYMBOL(dvb_unregister_adapter);
@@ -494,6 +507,8 @@ static int __init init_dvbdev(void)
 #else
 	dvb_class->devnode = dvb_devnode;
 #endif
+	/* statistics only, the core works fine without it */
+	dvb_debugfs_root = debugfs_create_dir("dvb", NULL);
 	return 0;
 
 error:
@@ -505,6 +520,8 @@ error:
 
 static void __exit exit_dvbdev(void)
 {
+	if (!IS_ERR_OR_NULL(dvb_debugfs_root))
+		debugfs_remove_recursive(dvb_debugfs_root);
 	class_destroy(dvb_class);
 	cdev_del(&dvb_device_cdev);
 	unregister_chrdev_region(MKDEV(DVB_MAJOR, 0), MAX_DVB_MINORS);
@@ -97,6 +97,9 @@ struct dvb_adapter {
 	int (*fe_ioctl_override)(struct dvb_frontend *fe,
 				 unsigned int cmd, void *parg,
 				 unsigned int stage);
+
+	/* debugfs directory for per-device statistics, may be NULL */
+	struct dentry *debugfs_dir;
 };
 
 
@@ -13,6 +13,10 @@
 
 extern int dvb_usb_debug;
 extern int dvb_usb_disable_rc_polling;
+extern int dvb_usb_rc_backoff;
+extern int dvb_usb_urb_count;
+extern int dvb_usb_urb_size;
+extern int dvb_usb_urb_defer;
 
 #define deb_info(args...)  dprintk(dvb_usb_debug,0x001,args)
 #define deb_xfer(args...)  dprintk(dvb_usb_debug,0x002,args)
@@ -36,6 +40,9 @@ extern int usb_urb_kill(struct usb_data_stream *stream);
 
 extern int dvb_usb_adapter_stream_init(struct dvb_usb_adapter *adap);
 extern int dvb_usb_adapter_stream_exit(struct dvb_usb_adapter *adap);
+extern int dvb_usb_adapter_stream_update(struct dvb_usb_adapter *adap);
+extern int dvb_usb_adapter_sysfs_init(struct dvb_usb_adapter *adap);
+extern void dvb_usb_adapter_sysfs_exit(struct dvb_usb_adapter *adap);
 
 extern int dvb_usb_i2c_init(struct dvb_usb_device *);
 extern int dvb_usb_i2c_exit(struct dvb_usb_device *);
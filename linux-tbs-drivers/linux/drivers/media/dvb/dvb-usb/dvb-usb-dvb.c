@@ -8,6 +8,9 @@
  */
 #include "dvb-usb-common.h"
 
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+
 /* does the complete input transfer handling */
 static int dvb_usb_ctrl_feed(struct dvb_demux_feed *dvbdmxfeed, int onoff)
 {
@@ -48,6 +51,13 @@ static int dvb_usb_ctrl_feed(struct dvb_demux_feed *dvbdmxfeed, int onoff)
 	 * for reception.
 	 */
 	if (adap->feedcount == onoff && adap->feedcount > 0) {
+		/* apply urb_count/urb_size changes while nothing is in flight */
+		ret = dvb_usb_adapter_stream_update(adap);
+		if (ret < 0) {
+			err("could not set up the URBs: error %d", ret);
+			return ret;
+		}
+
 		deb_ts("submitting all URBs\n");
 		usb_urb_submit(&adap->stream);
 
@@ -88,6 +98,61 @@ static int dvb_usb_stop_feed(struct dvb_demux_feed *dvbdmxfeed)
 	return dvb_usb_ctrl_feed(dvbdmxfeed,0);
 }
 
+static int dvb_usb_stream_debugfs_show(struct seq_file *m, void *v)
+{
+	struct dvb_usb_adapter *adap = m->private;
+	struct usb_data_stream *stream = &adap->stream;
+	unsigned int ms = 0;
+	u64 rate;
+
+	if (stream->urbs_submitted)
+		ms = jiffies_to_msecs(jiffies - stream->start_time);
+
+	seq_printf(m, "type:              %s\n",
+		   stream->props.type == USB_ISOC ? "isoc" : "bulk");
+	seq_printf(m, "urbs:              %d\n", stream->urbs_initialized);
+	seq_printf(m, "urbs submitted:    %d\n", stream->urbs_submitted);
+	seq_printf(m, "buffer size:       %lu\n", stream->buf_size);
+	seq_printf(m, "buffer region:     %s\n",
+		   stream->state & USB_STATE_URB_REGION ? "yes" : "no");
+	seq_printf(m, "streaming for:     %u ms\n", ms);
+	seq_printf(m, "urbs completed:    %lu\n", stream->urbs_completed);
+	seq_printf(m, "urb errors:        %lu\n", stream->urb_errors);
+	seq_printf(m, "bytes:             %llu\n",
+		   (unsigned long long)stream->bytes);
+	seq_printf(m, "deferred:          %s\n", stream->wq ? "yes" : "no");
+	if (stream->wq) {
+		seq_printf(m, "spare buffers:     %d\n", stream->nr_free);
+		seq_printf(m, "queue depth:       %u\n",
+			   stream->queue_head - stream->queue_tail);
+		seq_printf(m, "queue depth max:   %u\n", stream->queue_max);
+		seq_printf(m, "drops:             %lu\n", stream->drops);
+	}
+	if (ms) {
+		rate = (u64)stream->urbs_completed * 1000;
+		do_div(rate, ms);
+		seq_printf(m, "completions/s:     %llu\n", (unsigned long long)rate);
+		rate = stream->bytes * 8;
+		do_div(rate, ms);
+		seq_printf(m, "throughput:        %llu kbit/s\n",
+			   (unsigned long long)rate);
+	}
+	return 0;
+}
+
+static int dvb_usb_stream_debugfs_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, dvb_usb_stream_debugfs_show, inode->i_private);
+}
+
+static const struct file_operations dvb_usb_stream_debugfs_fops = {
+	.owner		= THIS_MODULE,
+	.open		= dvb_usb_stream_debugfs_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 int dvb_usb_adapter_dvb_init(struct dvb_usb_adapter *adap, short *adapter_nums)
 {
 	int ret = dvb_register_adapter(&adap->dvb_adap, adap->dev->desc->name,
@@ -131,6 +196,12 @@ int dvb_usb_adapter_dvb_init(struct dvb_usb_adapter *adap, short *adapter_nums)
 
 	dvb_net_init(&adap->dvb_adap, &adap->dvb_net, &adap->demux.dmx);
 
+	if (adap->dvb_adap.debugfs_dir)
+		adap->debugfs = debugfs_create_file("usb_stream", 0444,
+						    adap->dvb_adap.debugfs_dir,
+						    adap,
+						    &dvb_usb_stream_debugfs_fops);
+
 	adap->state |= DVB_USB_ADAP_STATE_DVB;
 	return 0;
 
@@ -146,6 +217,9 @@ int dvb_usb_adapter_dvb_exit(struct dvb_usb_adapter *adap)
 {
 	if (adap->state & DVB_USB_ADAP_STATE_DVB) {
 		deb_info("unregistering DVB part\n");
+		if (!IS_ERR_OR_NULL(adap->debugfs))
+			debugfs_remove(adap->debugfs);
+		adap->debugfs = NULL;
 		dvb_net_release(&adap->dvb_net);
 		adap->demux.dmx.close(&adap->demux.dmx);
 		dvb_dmxdev_release(&adap->dmxdev);
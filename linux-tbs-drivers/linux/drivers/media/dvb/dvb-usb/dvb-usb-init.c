@@ -22,6 +22,22 @@ int dvb_usb_disable_rc_polling;
 module_param_named(disable_rc_polling, dvb_usb_disable_rc_polling, int, 0644);
 MODULE_PARM_DESC(disable_rc_polling, "disable remote control polling (default: 0).");
 
+int dvb_usb_rc_backoff = 2;
+module_param_named(rc_backoff, dvb_usb_rc_backoff, int, 0644);
+MODULE_PARM_DESC(rc_backoff, "double the remote control query interval up to this many times while no key is pressed (default: 2, 0=off).");
+
+int dvb_usb_urb_count;
+module_param_named(urb_count, dvb_usb_urb_count, int, 0644);
+MODULE_PARM_DESC(urb_count, "number of URBs per TS stream, 0 uses the device default (max " __stringify(MAX_NO_URBS_FOR_DATA_STREAM) "). Can be changed per adapter in sysfs (adapterN_urb_count), takes effect when streaming starts.");
+
+int dvb_usb_urb_size;
+module_param_named(urb_size, dvb_usb_urb_size, int, 0644);
+MODULE_PARM_DESC(urb_size, "buffer size per bulk URB in bytes, 0 uses the device default. Can be changed per adapter in sysfs (adapterN_urb_size), takes effect when streaming starts.");
+
+int dvb_usb_urb_defer = 1;
+module_param_named(urb_defer, dvb_usb_urb_defer, int, 0644);
+MODULE_PARM_DESC(urb_defer, "resubmit bulk URBs with a spare buffer and demux the data from a workqueue (default: 1). Takes effect when streaming starts.");
+
 static int dvb_usb_force_pid_filter_usage;
 module_param_named(force_pid_filter_usage, dvb_usb_force_pid_filter_usage, int, 0444);
 MODULE_PARM_DESC(force_pid_filter_usage, "force all dvb-usb-devices to use a PID filter, if any (default: 0).");
@@ -71,6 +87,9 @@ static int dvb_usb_adapter_init(struct dvb_usb_device *d, short *adapter_nrs)
 			}
 		}
 
+		adap->urb_count = clamp(dvb_usb_urb_count, 0, MAX_NO_URBS_FOR_DATA_STREAM);
+		adap->urb_size  = clamp(dvb_usb_urb_size, 0, MAX_URB_BUFFER_SIZE);
+
 		if ((ret = dvb_usb_adapter_stream_init(adap)) ||
 			(ret = dvb_usb_adapter_dvb_init(adap, adapter_nrs)) ||
 			(ret = dvb_usb_adapter_frontend_init(adap))) {
@@ -81,6 +100,9 @@ static int dvb_usb_adapter_init(struct dvb_usb_device *d, short *adapter_nrs)
 		if (adap->fe[1])
 			adap->dvb_adap.mfe_shared = 1;
 
+		if (dvb_usb_adapter_sysfs_init(adap))
+			warn("could not create sysfs attributes for adapter %d.", n);
+
 		d->num_adapters_initialized++;
 		d->state |= DVB_USB_STATE_DVB;
 	}
@@ -102,6 +124,7 @@ static int dvb_usb_adapter_exit(struct dvb_usb_device *d)
 	int n;
 
 	for (n = 0; n < d->num_adapters_initialized; n++) {
+		dvb_usb_adapter_sysfs_exit(&d->adapter[n]);
 		dvb_usb_adapter_frontend_exit(&d->adapter[n]);
 		dvb_usb_adapter_dvb_exit(&d->adapter[n]);
 		dvb_usb_adapter_stream_exit(&d->adapter[n]);
@@ -178,6 +178,66 @@ static int legacy_dvb_usb_setkeycode(struct input_dev *dev,
 	return 0;
 }
 #endif
+/* queries without a key before the query interval is doubled */
+#define DVB_USB_RC_IDLE_QUERIES 50
+
+/*
+ * Next query interval: the driver's interval while keys arrive, doubled
+ * every DVB_USB_RC_IDLE_QUERIES idle queries up to rc_backoff times.
+ */
+static unsigned long dvb_usb_rc_interval(struct dvb_usb_device *d,
+					 int interval, int key)
+{
+	int shift;
+
+	if (key)
+		d->rc_idle = 0;
+	else if (d->rc_idle < UINT_MAX)
+		d->rc_idle++;
+
+	shift = min_t(unsigned int, d->rc_idle / DVB_USB_RC_IDLE_QUERIES,
+		      max(dvb_usb_rc_backoff, 0));
+	return msecs_to_jiffies(interval << min(shift, 4));
+}
+
+/* The remote is queried through the I2C bridge on most devices: leave the
+ * bus to the tuner while it is busy and try again one interval later. */
+static int dvb_usb_rc_busy(struct dvb_usb_device *d)
+{
+	return (d->state & DVB_USB_STATE_I2C) && mutex_is_locked(&d->i2c_mutex);
+}
+
+/* polling only runs while the rc input device is open */
+static void dvb_usb_rc_start(struct dvb_usb_device *d, int interval)
+{
+	d->rc_idle = 0;
+	d->rc_polling = 1;
+	schedule_delayed_work(&d->rc_query_work, msecs_to_jiffies(interval));
+}
+
+static void dvb_usb_rc_stop(struct dvb_usb_device *d)
+{
+	d->rc_polling = 0;
+	cancel_delayed_work_sync(&d->rc_query_work);
+}
+
+static int legacy_dvb_usb_rc_open(struct input_dev *dev)
+{
+	struct dvb_usb_device *d = input_get_drvdata(dev);
+
+	deb_rc("rc input opened, start polling\n");
+	dvb_usb_rc_start(d, d->props.rc.legacy.rc_interval);
+	return 0;
+}
+
+static void legacy_dvb_usb_rc_close(struct input_dev *dev)
+{
+	struct dvb_usb_device *d = input_get_drvdata(dev);
+
+	deb_rc("rc input closed, stop polling\n");
+	dvb_usb_rc_stop(d);
+}
+
 /* Remote-control poll function - called every dib->rc_query_interval ms to see
  * whether the remote control has received anything.
  *
@@ -188,15 +248,18 @@ static void legacy_dvb_usb_read_remote_control(struct work_struct *work)
 	struct dvb_usb_device *d =
 		container_of(work, struct dvb_usb_device, rc_query_work.work);
 	u32 event;
-	int state;
+	int state = REMOTE_NO_KEY_PRESSED;
 
-	/* TODO: need a lock here.  We can simply skip checking for the remote control
-	   if we're busy. */
-
-	/* when the parameter has been set to 1 via sysfs while the driver was running */
-	if (dvb_usb_disable_rc_polling)
+	/* when the parameter has been set to 1 via sysfs while the driver
+	 * was running, or when the input device was closed */
+	if (dvb_usb_disable_rc_polling || !d->rc_polling)
 		return;
 
+	if (dvb_usb_rc_busy(d)) {
+		deb_rc("i2c busy, skipping remote query\n");
+		goto schedule;
+	}
+
 	if (d->props.rc.legacy.rc_query(d,&event,&state)) {
 		err("error while querying for an remote control event.");
 		goto schedule;
@@ -256,7 +319,9 @@ static void legacy_dvb_usb_read_remote_control(struct work_struct *work)
 */
 
 schedule:
-	schedule_delayed_work(&d->rc_query_work,msecs_to_jiffies(d->props.rc.legacy.rc_interval));
+	schedule_delayed_work(&d->rc_query_work,
+			      dvb_usb_rc_interval(d, d->props.rc.legacy.rc_interval,
+						  state != REMOTE_NO_KEY_PRESSED));
 }
 
 static int legacy_dvb_usb_remote_init(struct dvb_usb_device *d)
@@ -306,22 +371,25 @@ static int legacy_dvb_usb_remote_init(struct dvb_usb_device *d)
 	input_dev->rep[REP_DELAY]  = d->props.rc.legacy.rc_interval + 150;
 
 	input_set_drvdata(input_dev, d);
-
-	err = input_register_device(input_dev);
-	if (err)
-		input_free_device(input_dev);
+	input_dev->open  = legacy_dvb_usb_rc_open;
+	input_dev->close = legacy_dvb_usb_rc_close;
 
 	rc_interval = d->props.rc.legacy.rc_interval;
 
 	INIT_DELAYED_WORK(&d->rc_query_work, legacy_dvb_usb_read_remote_control);
 
-	info("schedule remote query interval to %d msecs.", rc_interval);
-	schedule_delayed_work(&d->rc_query_work,
-			      msecs_to_jiffies(rc_interval));
+	err = input_register_device(input_dev);
+	if (err) {
+		input_free_device(input_dev);
+		return err;
+	}
+
+	info("remote query interval is %d msecs while the input device is open.",
+	     rc_interval);
 
 	d->state |= DVB_USB_STATE_REMOTE;
 
-	return err;
+	return 0;
 }
 
 /* Remote-control poll function - called every dib->rc_query_interval ms to see
@@ -335,21 +403,42 @@ static void dvb_usb_read_remote_control(struct work_struct *work)
 		container_of(work, struct dvb_usb_device, rc_query_work.work);
 	int err;
 
-	/* TODO: need a lock here.  We can simply skip checking for the remote control
-	   if we're busy. */
-
 	/* when the parameter has been set to 1 via sysfs while the
-	 * driver was running, or when bulk mode is enabled after IR init
+	 * driver was running, when bulk mode is enabled after IR init
+	 * or when the input device was closed
 	 */
-	if (dvb_usb_disable_rc_polling || d->props.rc.core.bulk_mode)
+	if (dvb_usb_disable_rc_polling || d->props.rc.core.bulk_mode ||
+	    !d->rc_polling)
 		return;
 
-	err = d->props.rc.core.rc_query(d);
-	if (err)
-		err("error %d while querying for an remote control event.", err);
+	if (dvb_usb_rc_busy(d)) {
+		deb_rc("i2c busy, skipping remote query\n");
+	} else {
+		err = d->props.rc.core.rc_query(d);
+		if (err)
+			err("error %d while querying for an remote control event.", err);
+	}
 
 	schedule_delayed_work(&d->rc_query_work,
-			      msecs_to_jiffies(d->props.rc.core.rc_interval));
+			      dvb_usb_rc_interval(d, d->props.rc.core.rc_interval,
+						  d->rc_dev->keypressed));
+}
+
+static int rc_core_dvb_usb_rc_open(struct rc_dev *dev)
+{
+	struct dvb_usb_device *d = dev->priv;
+
+	deb_rc("rc device opened, start polling\n");
+	dvb_usb_rc_start(d, d->props.rc.core.rc_interval);
+	return 0;
+}
+
+static void rc_core_dvb_usb_rc_close(struct rc_dev *dev)
+{
+	struct dvb_usb_device *d = dev->priv;
+
+	deb_rc("rc device closed, stop polling\n");
+	dvb_usb_rc_stop(d);
 }
 
 static int rc_core_dvb_usb_remote_init(struct dvb_usb_device *d)
@@ -372,26 +461,31 @@ static int rc_core_dvb_usb_remote_init(struct dvb_usb_device *d)
 	dev->dev.parent = &d->udev->dev;
 	dev->priv = d;
 
+	/* Polling mode - initialize a work queue for handling it, the
+	 * polling itself starts when the input device is opened */
+	INIT_DELAYED_WORK(&d->rc_query_work, dvb_usb_read_remote_control);
+	if (d->props.rc.core.rc_query && !d->props.rc.core.bulk_mode) {
+		dev->open  = rc_core_dvb_usb_rc_open;
+		dev->close = rc_core_dvb_usb_rc_close;
+	}
+
+	d->input_dev = NULL;
+	d->rc_dev = dev;
+
 	err = rc_register_device(dev);
 	if (err < 0) {
+		d->rc_dev = NULL;
 		rc_free_device(dev);
 		return err;
 	}
 
-	d->input_dev = NULL;
-	d->rc_dev = dev;
-
 	if (!d->props.rc.core.rc_query || d->props.rc.core.bulk_mode)
 		return 0;
 
-	/* Polling mode - initialize a work queue for handling it */
-	INIT_DELAYED_WORK(&d->rc_query_work, dvb_usb_read_remote_control);
-
 	rc_interval = d->props.rc.core.rc_interval;
 
-	info("schedule remote query interval to %d msecs.", rc_interval);
-	schedule_delayed_work(&d->rc_query_work,
-			      msecs_to_jiffies(rc_interval));
+	info("remote query interval is %d msecs while the input device is open.",
+	     rc_interval);
 
 	return 0;
 }
@@ -432,11 +526,12 @@ int dvb_usb_remote_init(struct dvb_usb_device *d)
 int dvb_usb_remote_exit(struct dvb_usb_device *d)
 {
 	if (d->state & DVB_USB_STATE_REMOTE) {
-		cancel_delayed_work_sync(&d->rc_query_work);
+		/* closing the input device stops the polling */
 		if (d->props.rc.mode == DVB_RC_LEGACY)
 			input_unregister_device(d->input_dev);
 		else
 			rc_unregister_device(d->rc_dev);
+		dvb_usb_rc_stop(d);
 	}
 	d->state &= ~DVB_USB_STATE_REMOTE;
 	return 0;
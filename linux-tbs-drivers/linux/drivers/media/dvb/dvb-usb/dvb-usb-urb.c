@@ -66,6 +66,134 @@ int dvb_usb_generic_write(struct dvb_usb_device *d, u8 *buf, u16 len)
 }
 EXPORT_SYMBOL(dvb_usb_generic_write);
 
+struct dvb_usb_ctrl_batch {
+	struct completion done;
+	atomic_t pending;
+	int status;
+};
+
+static void dvb_usb_ctrl_complete(struct urb *urb)
+{
+	struct dvb_usb_ctrl_batch *batch = urb->context;
+
+	/* control URBs of one endpoint complete in order */
+	if (urb->status && !batch->status)
+		batch->status = urb->status;
+	if (atomic_dec_and_test(&batch->pending))
+		complete(&batch->done);
+}
+
+/*
+ * Vendor control transfers as used by the Cypress FX2 based boxes, which
+ * need a separate request to start an I2C transfer and to fetch its data.
+ * Instead of one synchronous usb_control_msg() round trip per request, the
+ * whole batch is queued on endpoint 0 and the caller sleeps once, until the
+ * last transfer completed: the device acknowledges a request only after it
+ * was carried out, so no delays between the requests are needed.
+ *
+ * Returns the number of bytes transferred, or a negative error code; a
+ * failed transfer does not stop the ones already queued behind it.
+ */
+int dvb_usb_ctrl_msgs(struct usb_device *udev, struct dvb_usb_ctrl_msg *msgs,
+		      int num, int timeout_ms)
+{
+	struct dvb_usb_ctrl_batch batch;
+	struct usb_ctrlrequest *setup;
+	struct urb **urbs;
+	u8 *data, *mem;
+	int i, ret, submitted = 0, total = 0;
+	size_t size = 0;
+
+	if (num <= 0)
+		return -EINVAL;
+
+	for (i = 0; i < num; i++)
+		size += msgs[i].len;
+
+	urbs = kcalloc(num, sizeof(*urbs), GFP_KERNEL);
+	/* setup packets and data stages share one DMA-able block */
+	mem = kmalloc(num * sizeof(*setup) + size, GFP_KERNEL);
+	if (urbs == NULL || mem == NULL) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	init_completion(&batch.done);
+	atomic_set(&batch.pending, 1);
+	batch.status = 0;
+
+	setup = (struct usb_ctrlrequest *)mem;
+	data = mem + num * sizeof(*setup);
+	for (i = 0; i < num; i++) {
+		unsigned int pipe = msgs[i].dir == USB_DIR_IN ?
+			usb_rcvctrlpipe(udev, 0) : usb_sndctrlpipe(udev, 0);
+
+		urbs[i] = usb_alloc_urb(0, GFP_KERNEL);
+		if (urbs[i] == NULL) {
+			ret = -ENOMEM;
+			goto out;
+		}
+
+		setup[i].bRequestType = msgs[i].dir | USB_TYPE_VENDOR |
+					USB_RECIP_DEVICE;
+		setup[i].bRequest     = msgs[i].request;
+		setup[i].wValue       = cpu_to_le16(msgs[i].value);
+		setup[i].wIndex       = cpu_to_le16(msgs[i].index);
+		setup[i].wLength      = cpu_to_le16(msgs[i].len);
+		if (msgs[i].dir != USB_DIR_IN)
+			memcpy(data, msgs[i].buf, msgs[i].len);
+
+		usb_fill_control_urb(urbs[i], udev, pipe, (u8 *)&setup[i],
+				     data, msgs[i].len, dvb_usb_ctrl_complete,
+				     &batch);
+		data += msgs[i].len;
+	}
+
+	for (i = 0; i < num; i++) {
+		atomic_inc(&batch.pending);
+		ret = usb_submit_urb(urbs[i], GFP_KERNEL);
+		if (ret) {
+			atomic_dec(&batch.pending);
+			batch.status = ret;
+			break;
+		}
+		submitted++;
+	}
+
+	/* drop the bias, wait for whatever made it onto the bus */
+	if (!atomic_dec_and_test(&batch.pending) &&
+	    !wait_for_completion_timeout(&batch.done,
+					 msecs_to_jiffies(timeout_ms))) {
+		for (i = 0; i < submitted; i++)
+			usb_kill_urb(urbs[i]);
+		batch.status = -ETIMEDOUT;
+	}
+
+	ret = batch.status;
+	if (ret) {
+		deb_xfer("control batch of %d failed: %d\n", num, ret);
+		goto out;
+	}
+
+	data = mem + num * sizeof(*setup);
+	for (i = 0; i < num; i++) {
+		if (msgs[i].dir == USB_DIR_IN)
+			memcpy(msgs[i].buf, data, urbs[i]->actual_length);
+		total += urbs[i]->actual_length;
+		data += msgs[i].len;
+	}
+	ret = total;
+
+out:
+	if (urbs)
+		for (i = 0; i < num; i++)
+			usb_free_urb(urbs[i]);
+	kfree(urbs);
+	kfree(mem);
+	return ret;
+}
+EXPORT_SYMBOL(dvb_usb_ctrl_msgs);
+
 static void dvb_usb_data_complete(struct usb_data_stream *stream, u8 *buffer, size_t length)
 {
 	struct dvb_usb_adapter *adap = stream->user_priv;
@@ -80,18 +208,169 @@ static void dvb_usb_data_complete_204(struct usb_data_stream *stream, u8 *buffer
 		dvb_dmx_swfilter_204(&adap->demux, buffer, length);
 }
 
+/* stream properties of the adapter with the urb_count/urb_size overrides */
+static void dvb_usb_adapter_stream_props(struct dvb_usb_adapter *adap,
+		struct usb_data_stream_properties *props)
+{
+	*props = adap->props.stream;
+
+	if (adap->urb_count > 0)
+		props->count = min(adap->urb_count, MAX_NO_URBS_FOR_DATA_STREAM);
+
+	if (adap->urb_size > 0 && props->type == USB_BULK) {
+		int maxp = usb_maxpacket(adap->dev->udev,
+				usb_rcvbulkpipe(adap->dev->udev, props->endpoint), 0);
+		int size = min(adap->urb_size, MAX_URB_BUFFER_SIZE);
+
+		/* short packets terminate a bulk transfer, keep it a
+		 * multiple of the endpoint size */
+		if (maxp > 0)
+			size = max(maxp, size - size % maxp);
+		props->u.bulk.buffersize = size;
+	}
+}
+
 int dvb_usb_adapter_stream_init(struct dvb_usb_adapter *adap)
 {
+	struct usb_data_stream_properties props;
+	int ret;
+
 	adap->stream.udev      = adap->dev->udev;
 	if (adap->props.caps & DVB_USB_ADAP_RECEIVES_204_BYTE_TS)
 		adap->stream.complete = dvb_usb_data_complete_204;
 	else
 	adap->stream.complete  = dvb_usb_data_complete;
 	adap->stream.user_priv = adap;
-	return usb_urb_init(&adap->stream, &adap->props.stream);
+
+	dvb_usb_adapter_stream_props(adap, &props);
+	ret = usb_urb_init(&adap->stream, &props);
+	if (ret == -ENOMEM && memcmp(&props, &adap->props.stream, sizeof(props))) {
+		err("no memory for %d URBs, using the driver defaults.",
+		    props.count);
+		ret = usb_urb_init(&adap->stream, &adap->props.stream);
+	}
+	return ret;
+}
+
+/*
+ * Called before the URBs are submitted: re-creates the stream if urb_count
+ * or urb_size were changed since it was set up.
+ */
+int dvb_usb_adapter_stream_update(struct dvb_usb_adapter *adap)
+{
+	struct usb_data_stream_properties props;
+
+	if (adap->stream.urbs_submitted)
+		return 0;
+
+	dvb_usb_adapter_stream_props(adap, &props);
+	if (adap->stream.urbs_initialized &&
+	    !memcmp(&props, &adap->stream.props, sizeof(props)) &&
+	    (props.type != USB_BULK ||
+	     !dvb_usb_urb_defer == !adap->stream.wq))
+		return 0;
+
+	deb_info("adapter %d: re-creating stream with %d URBs\n",
+		 adap->id, props.count);
+	usb_urb_exit(&adap->stream);
+	return dvb_usb_adapter_stream_init(adap);
 }
 
 int dvb_usb_adapter_stream_exit(struct dvb_usb_adapter *adap)
 {
 	return usb_urb_exit(&adap->stream);
 }
+
+/* sysfs: adapterN_urb_count and adapterN_urb_size of the USB device */
+static ssize_t dvb_usb_urb_count_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct dvb_usb_adapter *adap =
+		container_of(attr, struct dvb_usb_adapter, urb_count_attr);
+
+	/* a pending request is shown until streaming picks it up */
+	return sprintf(buf, "%d\n",
+		       adap->urb_count ? adap->urb_count : adap->stream.props.count);
+}
+
+static ssize_t dvb_usb_urb_count_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct dvb_usb_adapter *adap =
+		container_of(attr, struct dvb_usb_adapter, urb_count_attr);
+	unsigned long val;
+
+	if (strict_strtoul(buf, 0, &val) || val > MAX_NO_URBS_FOR_DATA_STREAM)
+		return -EINVAL;
+
+	adap->urb_count = val;
+	return count;
+}
+
+static ssize_t dvb_usb_urb_size_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct dvb_usb_adapter *adap =
+		container_of(attr, struct dvb_usb_adapter, urb_size_attr);
+
+	return sprintf(buf, "%lu\n",
+		       adap->urb_size ? adap->urb_size : adap->stream.buf_size);
+}
+
+static ssize_t dvb_usb_urb_size_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct dvb_usb_adapter *adap =
+		container_of(attr, struct dvb_usb_adapter, urb_size_attr);
+	unsigned long val;
+
+	if (strict_strtoul(buf, 0, &val) || val > MAX_URB_BUFFER_SIZE)
+		return -EINVAL;
+
+	adap->urb_size = val;
+	return count;
+}
+
+int dvb_usb_adapter_sysfs_init(struct dvb_usb_adapter *adap)
+{
+	struct device *dev = &adap->dev->udev->dev;
+	int ret;
+
+	snprintf(adap->urb_count_name, sizeof(adap->urb_count_name),
+		 "adapter%d_urb_count", adap->id);
+	sysfs_attr_init(&adap->urb_count_attr.attr);
+	adap->urb_count_attr.attr.name = adap->urb_count_name;
+	adap->urb_count_attr.attr.mode = S_IRUGO | S_IWUSR;
+	adap->urb_count_attr.show      = dvb_usb_urb_count_show;
+	adap->urb_count_attr.store     = dvb_usb_urb_count_store;
+
+	snprintf(adap->urb_size_name, sizeof(adap->urb_size_name),
+		 "adapter%d_urb_size", adap->id);
+	sysfs_attr_init(&adap->urb_size_attr.attr);
+	adap->urb_size_attr.attr.name = adap->urb_size_name;
+	adap->urb_size_attr.attr.mode = S_IRUGO | S_IWUSR;
+	adap->urb_size_attr.show      = dvb_usb_urb_size_show;
+	adap->urb_size_attr.store     = dvb_usb_urb_size_store;
+
+	ret = device_create_file(dev, &adap->urb_count_attr);
+	if (ret)
+		return ret;
+	ret = device_create_file(dev, &adap->urb_size_attr);
+	if (ret) {
+		device_remove_file(dev, &adap->urb_count_attr);
+		return ret;
+	}
+	return 0;
+}
+
+void dvb_usb_adapter_sysfs_exit(struct dvb_usb_adapter *adap)
+{
+	struct device *dev = &adap->dev->udev->dev;
+
+	if (adap->urb_count_attr.attr.name)
+		device_remove_file(dev, &adap->urb_count_attr);
+	if (adap->urb_size_attr.attr.name)
+		device_remove_file(dev, &adap->urb_size_attr);
+	adap->urb_count_attr.attr.name = NULL;
+	adap->urb_size_attr.attr.name = NULL;
+}
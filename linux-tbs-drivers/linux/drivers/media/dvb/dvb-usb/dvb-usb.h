@@ -300,14 +300,30 @@ struct dvb_usb_device_properties {
  *
  * @urbs_initialized: number of URBs initialized.
  * @urbs_submitted: number of URBs submitted.
+ *
+ * @start_time: jiffies when the URBs were last submitted.
+ * @urbs_completed: URBs completed since @start_time.
+ * @urb_errors: URBs (or iso frames) completed with an error.
+ * @bytes: payload bytes handed to @complete since @start_time.
+ *
+ * @wq: ordered workqueue running @complete for bulk streams, NULL when
+ *  @complete is called from the URB completion handler.
+ * @buf_lock: protects @free_bufs and @queue.
+ * @free_bufs: spare buffers not owned by an URB or @queue.
+ * @queue: filled buffers waiting for @work.
+ * @queue_max: highest number of queued buffers since @start_time.
+ * @drops: URBs whose data was dropped for lack of a spare buffer.
  */
-#define MAX_NO_URBS_FOR_DATA_STREAM 10
+#define MAX_NO_URBS_FOR_DATA_STREAM 32
+#define MAX_NO_BUFS_FOR_DATA_STREAM (2 * MAX_NO_URBS_FOR_DATA_STREAM)
+#define MAX_URB_BUFFER_SIZE         (128 * 1024)
 struct usb_data_stream {
 	struct usb_device                 *udev;
 	struct usb_data_stream_properties  props;
 
-#define USB_STATE_INIT    0x00
-#define USB_STATE_URB_BUF 0x01
+#define USB_STATE_INIT       0x00
+#define USB_STATE_URB_BUF    0x01
+#define USB_STATE_URB_REGION 0x02 /* buffers share one coherent region */
 	int state;
 
 	void (*complete) (struct usb_data_stream *, u8 *, size_t);
@@ -315,12 +331,32 @@ struct usb_data_stream {
 	struct urb    *urb_list[MAX_NO_URBS_FOR_DATA_STREAM];
 	int            buf_num;
 	unsigned long  buf_size;
-	u8            *buf_list[MAX_NO_URBS_FOR_DATA_STREAM];
-	dma_addr_t     dma_addr[MAX_NO_URBS_FOR_DATA_STREAM];
+	u8            *buf_list[MAX_NO_BUFS_FOR_DATA_STREAM];
+	dma_addr_t     dma_addr[MAX_NO_BUFS_FOR_DATA_STREAM];
 
 	int urbs_initialized;
 	int urbs_submitted;
 
+	unsigned long start_time;
+	unsigned long urbs_completed;
+	unsigned long urb_errors;
+	u64           bytes;
+
+	struct workqueue_struct *wq;
+	struct work_struct       work;
+	char                     wq_name[24];
+	spinlock_t               buf_lock;
+	int                      free_bufs[MAX_NO_BUFS_FOR_DATA_STREAM];
+	int                      nr_free;
+	struct {
+		int buf;
+		int len;
+	}                        queue[MAX_NO_BUFS_FOR_DATA_STREAM];
+	unsigned int             queue_head;
+	unsigned int             queue_tail;
+	unsigned int             queue_max;
+	unsigned long            drops;
+
 	void *user_priv;
 };
 
@@ -348,6 +384,12 @@ struct usb_data_stream {
  * @fe_sleep: rerouted frontend-sleep function.
  *
  * @stream: the usb data stream.
+ * @urb_count: URB count requested via module option or sysfs (0: default).
+ * @urb_size: URB buffer size requested via module option or sysfs
+ *  (0: default, bulk streams only).
+ * @urb_count_attr: sysfs attribute adapterN_urb_count of the USB device.
+ * @urb_size_attr: sysfs attribute adapterN_urb_size of the USB device.
+ * @debugfs: per adapter usb_stream statistics file.
  */
 #define MAX_NO_OF_FE_PER_ADAP 2
 struct dvb_usb_adapter {
@@ -376,6 +418,14 @@ struct dvb_usb_adapter {
 
 	struct usb_data_stream stream;
 
+	int urb_count;
+	int urb_size;
+	char urb_count_name[24];
+	char urb_size_name[24];
+	struct device_attribute urb_count_attr;
+	struct device_attribute urb_size_attr;
+	struct dentry *debugfs;
+
 	void *priv;
 };
 
@@ -397,6 +447,8 @@ struct dvb_usb_adapter {
  * @rc_dev: rc device for the remote control (rc-core mode)
  * @input_dev: input device for the remote control (legacy mode)
  * @rc_query_work: struct work_struct frequent rc queries
+ * @rc_polling: the rc input device is open, @rc_query_work is running
+ * @rc_idle: consecutive queries without a key, see dvb_usb_rc_interval()
  * @last_event: last triggered event
  * @last_state: last state (no, pressed, repeat)
  * @owner: owner of the dvb_adapter
@@ -432,6 +484,8 @@ struct dvb_usb_device {
 	struct input_dev *input_dev;
 	char rc_phys[64];
 	struct delayed_work rc_query_work;
+	int rc_polling;
+	unsigned int rc_idle;
 	u32 last_event;
 	int last_state;
 
@@ -450,6 +504,28 @@ extern void dvb_usb_device_exit(struct usb_interface *);
 extern int dvb_usb_generic_rw(struct dvb_usb_device *, u8 *, u16, u8 *, u16,int);
 extern int dvb_usb_generic_write(struct dvb_usb_device *, u8 *, u16);
 
+/**
+ * struct dvb_usb_ctrl_msg - one vendor control transfer of a batch
+ * @request: vendor request code.
+ * @dir: USB_DIR_OUT or USB_DIR_IN.
+ * @value: wValue of the setup packet.
+ * @index: wIndex of the setup packet.
+ * @buf: data to send or buffer for the received data, need not be DMA-able.
+ * @len: length of @buf.
+ */
+struct dvb_usb_ctrl_msg {
+	u8  request;
+	u8  dir;
+	u16 value;
+	u16 index;
+	u8 *buf;
+	u16 len;
+};
+
+/* submits all messages to endpoint 0 at once and waits for the last one */
+extern int dvb_usb_ctrl_msgs(struct usb_device *, struct dvb_usb_ctrl_msg *,
+			     int, int timeout_ms);
+
 /* commonly used remote control parsing */
 extern int dvb_usb_nec_rc_key_to_event(struct dvb_usb_device *, u8[], u32 *, int *);
 
@@ -38,22 +38,28 @@ DVB_DEFINE_MOD_OPT_ADAPTER_NR(adapter_nr);
 static int tbs5220_op_rw(struct usb_device *dev, u8 request, u16 value,
 				u16 index, u8 * data, u16 len, int flags)
 {
-	int ret;
-	u8 u8buf[len];
+	struct dvb_usb_ctrl_msg msg = {
+		.request = request,
+		.dir     = flags == TBS5220_READ_MSG ? USB_DIR_IN : USB_DIR_OUT,
+		.value   = value,
+		.index   = index,
+		.buf     = data,
+		.len     = len,
+	};
 
-	unsigned int pipe = (flags == TBS5220_READ_MSG) ?
-			usb_rcvctrlpipe(dev, 0) : usb_sndctrlpipe(dev, 0);
-	u8 request_type = (flags == TBS5220_READ_MSG) ? USB_DIR_IN : 
-								USB_DIR_OUT;
+	return dvb_usb_ctrl_msgs(dev, &msg, 1, 2000);
+}
 
-	if (flags == TBS5220_WRITE_MSG)
-		memcpy(u8buf, data, len);
-	ret = usb_control_msg(dev, pipe, request, request_type | 
-			USB_TYPE_VENDOR, value, index , u8buf, len, 2000);
+/* I2C read: start the transfer with wreq, fetch the data with 0x91 */
+static int tbs5220_op_wr_rd(struct usb_device *dev, u8 wreq, u8 *wbuf, u16 wlen,
+			u8 *rbuf, u16 rlen)
+{
+	struct dvb_usb_ctrl_msg xfer[2] = {
+		{ .request = wreq, .dir = USB_DIR_OUT, .buf = wbuf, .len = wlen },
+		{ .request = 0x91, .dir = USB_DIR_IN,  .buf = rbuf, .len = rlen },
+	};
 
-	if (flags == TBS5220_READ_MSG)
-		memcpy(data, u8buf, len);
-	return ret;
+	return dvb_usb_ctrl_msgs(dev, xfer, 2, 2000);
 }
 
 /* I2C */
@@ -61,7 +67,7 @@ static int tbs5220_i2c_transfer(struct i2c_adapter *adap,
 					struct i2c_msg msg[], int num)
 {
 	struct dvb_usb_device *d = i2c_get_adapdata(adap);
-	int i = 0;
+	int i = 0, ret = 0;
 	u8 buf6[20];
 	u8 inbuf[20];
 
@@ -77,11 +83,8 @@ static int tbs5220_i2c_transfer(struct i2c_adapter *adap,
 		//register
 		buf6[2] = msg[0].buf[0];
 
-		tbs5220_op_rw(d->udev, 0x90, 0, 0,
-					buf6, 3, TBS5220_WRITE_MSG);
-		//msleep(5);
-		tbs5220_op_rw(d->udev, 0x91, 0, 0,
-					inbuf, buf6[0], TBS5220_READ_MSG);
+		ret = tbs5220_op_wr_rd(d->udev, 0x90, buf6, 3,
+					inbuf, buf6[0]);
 		memcpy(msg[1].buf, inbuf, msg[1].len);
 		break;
 	case 1:
@@ -94,26 +97,21 @@ static int tbs5220_i2c_transfer(struct i2c_adapter *adap,
 				for(i=0;i<msg[0].len;i++) {
 					buf6[2+i] = msg[0].buf[i];//register
 				}
-				tbs5220_op_rw(d->udev, 0x80, 0, 0,
+				ret = tbs5220_op_rw(d->udev, 0x80, 0, 0,
 					buf6, msg[0].len+2, TBS5220_WRITE_MSG);
 			} else {
 				buf6[0] = msg[0].len;//length
 				buf6[1] = (msg[0].addr<<1) | 0x01;//addr
-				tbs5220_op_rw(d->udev, 0x93, 0, 0,
-						buf6, 2, TBS5220_WRITE_MSG);
-				//msleep(5);
-				tbs5220_op_rw(d->udev, 0x91, 0, 0,
-					inbuf, buf6[0], TBS5220_READ_MSG);
+				ret = tbs5220_op_wr_rd(d->udev, 0x93, buf6, 2,
+						inbuf, buf6[0]);
 				memcpy(msg[0].buf, inbuf, msg[0].len);
 			}
-			//msleep(3);
 			break;
 		case (TBS5220_RC_QUERY):
-			tbs5220_op_rw(d->udev, 0xb8, 0, 0,
+			ret = tbs5220_op_rw(d->udev, 0xb8, 0, 0,
 					buf6, 4, TBS5220_READ_MSG);
 			msg[0].buf[0] = buf6[2];
 			msg[0].buf[1] = buf6[3];
-			//msleep(3);
 			//info("TBS5220_RC_QUERY %x %x %x %x\n",
 			//		buf6[0],buf6[1],buf6[2],buf6[3]);
 			break;
@@ -123,7 +121,7 @@ static int tbs5220_i2c_transfer(struct i2c_adapter *adap,
 	}
 
 	mutex_unlock(&d->i2c_mutex);
-	return num;
+	return ret < 0 ? ret : num;
 }
 
 static u32 tbs5220_i2c_func(struct i2c_adapter *adapter)
@@ -145,30 +143,31 @@ static struct i2c_algorithm tbs5220_i2c_algo = {
 
 static int tbs5220_read_mac_address(struct dvb_usb_device *d, u8 mac[6])
 {
-	int i,ret;
-	u8 ibuf[3] = {0, 0,0};
-	u8 eeprom[256], eepromline[16];
-
-	for (i = 0; i < 256; i++) {
-		ibuf[0]=1;//lenth
-		ibuf[1]=0xa0;//eeprom addr
-		ibuf[2]=i;//register
-		ret = tbs5220_op_rw(d->udev, 0x90, 0, 0,
-					ibuf, 3, TBS5220_WRITE_MSG);
-		ret = tbs5220_op_rw(d->udev, 0x91, 0, 0,
-					ibuf, 1, TBS5220_READ_MSG);
-			if (ret < 0) {
-				err("read eeprom failed.");
-				return -1;
-			} else {
-				eepromline[i%16] = ibuf[0];
-				eeprom[i] = ibuf[0];
-			}
-			
-			if ((i % 16) == 15) {
-				deb_xfer("%02x: ", i - 15);
-				debug_dump(eepromline, 16, deb_xfer);
-			}
+	struct dvb_usb_ctrl_msg xfer[32];
+	u8 obuf[16][3];
+	u8 eeprom[256];
+	int i, j, ret;
+
+	/* one batch per 16 bytes: address each byte, then fetch it */
+	for (i = 0; i < 256; i += 16) {
+		for (j = 0; j < 16; j++) {
+			obuf[j][0] = 1;//lenth
+			obuf[j][1] = 0xa0;//eeprom addr
+			obuf[j][2] = i + j;//register
+			xfer[2 * j] = (struct dvb_usb_ctrl_msg) {
+				.request = 0x90, .dir = USB_DIR_OUT,
+				.buf = obuf[j], .len = 3 };
+			xfer[2 * j + 1] = (struct dvb_usb_ctrl_msg) {
+				.request = 0x91, .dir = USB_DIR_IN,
+				.buf = eeprom + i + j, .len = 1 };
+		}
+		ret = dvb_usb_ctrl_msgs(d->udev, xfer, 32, 2000);
+		if (ret < 0) {
+			err("read eeprom failed.");
+			return -1;
+		}
+		deb_xfer("%02x: ", i);
+		debug_dump((eeprom + i), 16, deb_xfer);
 	}
 	memcpy(mac, eeprom + 16, 6);
 	return 0;
@@ -10,6 +10,77 @@
  */
 #include "dvb-usb-common.h"
 
+#define QUEUE_MASK (MAX_NO_BUFS_FOR_DATA_STREAM - 1)
+
+/* bottom half of deferred bulk streams: demux the queued buffers in order
+ * and hand them back to the spare pool */
+static void usb_urb_work(struct work_struct *work)
+{
+	struct usb_data_stream *stream =
+		container_of(work, struct usb_data_stream, work);
+	int buf, len;
+
+	spin_lock_irq(&stream->buf_lock);
+	while (stream->queue_tail != stream->queue_head) {
+		buf = stream->queue[stream->queue_tail & QUEUE_MASK].buf;
+		len = stream->queue[stream->queue_tail & QUEUE_MASK].len;
+		spin_unlock_irq(&stream->buf_lock);
+
+		stream->complete(stream, stream->buf_list[buf], len);
+
+		spin_lock_irq(&stream->buf_lock);
+		stream->queue_tail++;
+		stream->free_bufs[stream->nr_free++] = buf;
+	}
+	spin_unlock_irq(&stream->buf_lock);
+}
+
+static int usb_urb_buf_index(struct usb_data_stream *stream, u8 *b)
+{
+	int i;
+
+	for (i = 0; i < stream->buf_num; i++)
+		if (stream->buf_list[i] == b)
+			return i;
+	return -1;
+}
+
+/* Queue the filled buffer of a bulk URB and give the URB a spare one, so it
+ * can be resubmitted before the data is demuxed. Without a spare buffer the
+ * data is dropped; the demux is behind anyway and stalling the endpoint
+ * would lose more. */
+static void usb_urb_defer(struct usb_data_stream *stream, struct urb *urb)
+{
+	unsigned long flags;
+	unsigned int depth;
+	int buf, spare;
+
+	buf = usb_urb_buf_index(stream, urb->transfer_buffer);
+	if (buf < 0)
+		return;
+
+	spin_lock_irqsave(&stream->buf_lock, flags);
+	if (stream->nr_free == 0) {
+		stream->drops++;
+		spin_unlock_irqrestore(&stream->buf_lock, flags);
+		return;
+	}
+	spare = stream->free_bufs[--stream->nr_free];
+
+	stream->queue[stream->queue_head & QUEUE_MASK].buf = buf;
+	stream->queue[stream->queue_head & QUEUE_MASK].len = urb->actual_length;
+	stream->queue_head++;
+	depth = stream->queue_head - stream->queue_tail;
+	if (depth > stream->queue_max)
+		stream->queue_max = depth;
+	spin_unlock_irqrestore(&stream->buf_lock, flags);
+
+	urb->transfer_buffer = stream->buf_list[spare];
+	urb->transfer_dma    = stream->dma_addr[spare];
+
+	queue_work(stream->wq, &stream->work);
+}
+
 /* URB stuff for streaming */
 static void usb_urb_complete(struct urb *urb)
 {
@@ -33,18 +104,24 @@ static void usb_urb_complete(struct urb *urb)
 			return;
 		default:        /* error */
 			deb_ts("urb completition error %d.\n", urb->status);
+			stream->urb_errors++;
 			break;
 	}
 
+	stream->urbs_completed++;
+
 	b = (u8 *) urb->transfer_buffer;
 	switch (ptype) {
 		case PIPE_ISOCHRONOUS:
 			for (i = 0; i < urb->number_of_packets; i++) {
 
-				if (urb->iso_frame_desc[i].status != 0)
+				if (urb->iso_frame_desc[i].status != 0) {
 					deb_ts("iso frame descriptor has an error: %d\n",urb->iso_frame_desc[i].status);
-				else if (urb->iso_frame_desc[i].actual_length > 0)
+					stream->urb_errors++;
+				} else if (urb->iso_frame_desc[i].actual_length > 0) {
+					stream->bytes += urb->iso_frame_desc[i].actual_length;
 					stream->complete(stream, b + urb->iso_frame_desc[i].offset, urb->iso_frame_desc[i].actual_length);
+				}
 
 				urb->iso_frame_desc[i].status = 0;
 				urb->iso_frame_desc[i].actual_length = 0;
@@ -52,8 +129,13 @@ static void usb_urb_complete(struct urb *urb)
 			debug_dump(b,20,deb_uxfer);
 			break;
 		case PIPE_BULK:
-			if (urb->actual_length > 0)
-				stream->complete(stream, b, urb->actual_length);
+			if (urb->actual_length > 0) {
+				stream->bytes += urb->actual_length;
+				if (stream->wq)
+					usb_urb_defer(stream, urb);
+				else
+					stream->complete(stream, b, urb->actual_length);
+			}
 			break;
 		default:
 			err("unknown endpoint type in completition handler.");
@@ -72,12 +154,24 @@ int usb_urb_kill(struct usb_data_stream *stream)
 		usb_kill_urb(stream->urb_list[i]);
 	}
 	stream->urbs_submitted = 0;
+
+	/* all URBs are back, let the bottom half drain the queue */
+	if (stream->wq)
+		flush_workqueue(stream->wq);
 	return 0;
 }
 
 int usb_urb_submit(struct usb_data_stream *stream)
 {
 	int i,ret;
+
+	stream->start_time     = jiffies;
+	stream->urbs_completed = 0;
+	stream->urb_errors     = 0;
+	stream->bytes          = 0;
+	stream->queue_max      = 0;
+	stream->drops          = 0;
+
 	for (i = 0; i < stream->urbs_initialized; i++) {
 		deb_ts("submitting URB no. %d\n",i);
 		if ((ret = usb_submit_urb(stream->urb_list[i],GFP_ATOMIC))) {
@@ -92,7 +186,12 @@ int usb_urb_submit(struct usb_data_stream *stream)
 
 static int usb_free_stream_buffers(struct usb_data_stream *stream)
 {
-	if (stream->state & USB_STATE_URB_BUF) {
+	if (stream->state & USB_STATE_URB_REGION) {
+		deb_mem("freeing buffer region\n");
+		usb_free_coherent(stream->udev, stream->buf_num * stream->buf_size,
+				  stream->buf_list[0], stream->dma_addr[0]);
+		stream->buf_num = 0;
+	} else if (stream->state & USB_STATE_URB_BUF) {
 		while (stream->buf_num) {
 			stream->buf_num--;
 			deb_mem("freeing buffer %d\n",stream->buf_num);
@@ -102,11 +201,36 @@ static int usb_free_stream_buffers(struct usb_data_stream *stream)
 		}
 	}
 
-	stream->state &= ~USB_STATE_URB_BUF;
+	stream->state &= ~(USB_STATE_URB_BUF | USB_STATE_URB_REGION);
 
 	return 0;
 }
 
+/* Carve all URB buffers out of one coherent allocation: one IOMMU/bounce
+ * mapping instead of one per URB, and neighbouring URBs stay adjacent in
+ * memory. Falls back to per-URB buffers if the region cannot be had. */
+static int usb_allocate_stream_region(struct usb_data_stream *stream, int num, unsigned long size)
+{
+	dma_addr_t dma;
+	u8 *region;
+	int i;
+
+	region = usb_alloc_coherent(stream->udev, num * size, GFP_KERNEL, &dma);
+	if (region == NULL)
+		return -ENOMEM;
+
+	memset(region, 0, num * size);
+	for (i = 0; i < num; i++) {
+		stream->buf_list[i] = region + i * size;
+		stream->dma_addr[i] = dma + i * size;
+	}
+	stream->buf_num = num;
+	stream->state |= USB_STATE_URB_REGION;
+
+	deb_mem("buffer region: %p (dma: %Lu)\n", region, (long long)dma);
+	return 0;
+}
+
 static int usb_allocate_stream_buffers(struct usb_data_stream *stream, int num, unsigned long size)
 {
 	stream->buf_num = 0;
@@ -114,6 +238,18 @@ static int usb_allocate_stream_buffers(struct usb_data_stream *stream, int num,
 
 	deb_mem("all in all I will use %lu bytes for streaming\n",num*size);
 
+	if (num > MAX_NO_BUFS_FOR_DATA_STREAM) {
+		err("%d buffers requested, only %d supported.", num,
+		    MAX_NO_BUFS_FOR_DATA_STREAM);
+		return -EINVAL;
+	}
+
+	if (usb_allocate_stream_region(stream, num, size) == 0) {
+		deb_mem("allocation successful\n");
+		return 0;
+	}
+	deb_mem("no buffer region, allocating per URB\n");
+
 	for (stream->buf_num = 0; stream->buf_num < num; stream->buf_num++) {
 		deb_mem("allocating buffer %d\n",stream->buf_num);
 		if (( stream->buf_list[stream->buf_num] =
@@ -134,21 +270,54 @@ stream->buf_list[stream->buf_num], (long long)stream->dma_addr[stream->buf_num])
 	return 0;
 }
 
+/* one spare buffer per URB and the workqueue for a deferred bulk stream */
+static int usb_bulk_defer_init(struct usb_data_stream *stream)
+{
+	int i;
+
+	snprintf(stream->wq_name, sizeof(stream->wq_name), "dvb-usb-%d.%d",
+		 stream->udev->devnum, stream->props.endpoint);
+	stream->wq = create_singlethread_workqueue(stream->wq_name);
+	if (stream->wq == NULL)
+		return -ENOMEM;
+
+	INIT_WORK(&stream->work, usb_urb_work);
+	spin_lock_init(&stream->buf_lock);
+	stream->queue_head = stream->queue_tail = 0;
+	stream->nr_free = 0;
+	for (i = stream->props.count; i < stream->buf_num; i++)
+		stream->free_bufs[stream->nr_free++] = i;
+
+	return 0;
+}
+
 static int usb_bulk_urb_init(struct usb_data_stream *stream)
 {
-	int i, j;
+	int i, j, num = stream->props.count;
 
-	if ((i = usb_allocate_stream_buffers(stream,stream->props.count,
+	if (dvb_usb_urb_defer)
+		num *= 2;
+
+	if ((i = usb_allocate_stream_buffers(stream,num,
 					stream->props.u.bulk.buffersize)) < 0)
 		return i;
 
+	if (dvb_usb_urb_defer && usb_bulk_defer_init(stream) < 0)
+		err("no workqueue for the stream, demuxing in the URB completion.");
+
 	/* allocate the URBs */
 	for (i = 0; i < stream->props.count; i++) {
 		stream->urb_list[i] = usb_alloc_urb(0, GFP_ATOMIC);
 		if (!stream->urb_list[i]) {
 			deb_mem("not enough memory for urb_alloc_urb!.\n");
 			for (j = 0; j < i; j++)
-				usb_free_urb(stream->urb_list[i]);
+				usb_free_urb(stream->urb_list[j]);
+			stream->urbs_initialized = 0;
+			if (stream->wq) {
+				destroy_workqueue(stream->wq);
+				stream->wq = NULL;
+			}
+			usb_free_stream_buffers(stream);
 			return -ENOMEM;
 		}
 		usb_fill_bulk_urb( stream->urb_list[i], stream->udev,
@@ -181,7 +350,9 @@ static int usb_isoc_urb_init(struct usb_data_stream *stream)
 		if (!stream->urb_list[i]) {
 			deb_mem("not enough memory for urb_alloc_urb!\n");
 			for (j = 0; j < i; j++)
-				usb_free_urb(stream->urb_list[i]);
+				usb_free_urb(stream->urb_list[j]);
+			stream->urbs_initialized = 0;
+			usb_free_stream_buffers(stream);
 			return -ENOMEM;
 		}
 
@@ -249,6 +420,11 @@ int usb_urb_exit(struct usb_data_stream *stream)
 	}
 	stream->urbs_initialized = 0;
 
+	if (stream->wq) {
+		destroy_workqueue(stream->wq);
+		stream->wq = NULL;
+	}
+
 	usb_free_stream_buffers(stream);
 	return 0;
 }
@@ -0,0 +1,685 @@
+/*
+ * dvbvirt.c - virtual DVB bridge feeding a transport stream from memory
+ *
+ * Registers a number of adapters with dummy frontends. Each adapter plays
+ * a transport stream held in a kernel buffer in a loop, paced by a hrtimer
+ * that stands in for the DMA interrupt of a real bridge: the timer
+ * schedules a tasklet, the tasklet copies one buffer worth of packets the
+ * way a DMA engine would and hands it to dvb_dmx_swfilter_packets(). This
+ * gives demux, dmxdev and dvb_net the same load pattern as a PCI bridge,
+ * without any hardware.
+ *
+ * The stream comes from a file loaded at module load (ts_file, looked up
+ * like firmware), from writes to /dev/dvbvirtN, or, when neither is given,
+ * from a synthetic pattern of synth_pids PIDs starting at 0x100.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/hrtimer.h>
+#include <linux/interrupt.h>
+#include <linux/miscdevice.h>
+#include <linux/fs.h>
+#include <linux/uaccess.h>
+#include <linux/firmware.h>
+#include <linux/platform_device.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+
+#include "demux.h"
+#include "dmxdev.h"
+#include "dvb_demux.h"
+#include "dvb_frontend.h"
+#include "dvb_net.h"
+#include "dvbdev.h"
+#include "dvb_dummy_fe.h"
+
+DVB_DEFINE_MOD_OPT_ADAPTER_NR(adapter_nr);
+
+#define DRIVER_NAME		"dvbvirt"
+
+#define DVBVIRT_MAX_ADAPTERS	8
+#define DVBVIRT_TS_SIZE		188
+/* synthetic PIDs run from 0x100 up to the last PID below the null PID */
+#define DVBVIRT_MAX_SYNTH_PIDS	0x1eff
+/* buffers a late tasklet may catch up on before ticks are dropped */
+#define DVBVIRT_MAX_CATCHUP	8
+/* bytes copied from user space per step of a control device write */
+#define DVBVIRT_WRITE_CHUNK	(64 * DVBVIRT_TS_SIZE)
+
+static unsigned int adapters = 1;
+module_param(adapters, uint, 0444);
+MODULE_PARM_DESC(adapters, "number of adapters to register (1-"
+		 __stringify(DVBVIRT_MAX_ADAPTERS) ", default 1)");
+
+static unsigned int bitrate = 80000;
+module_param(bitrate, uint, 0644);
+MODULE_PARM_DESC(bitrate, "stream rate per adapter in kbit/s, "
+		 "read when streaming starts (default 80000)");
+
+static unsigned int buf_packets = 512;
+module_param(buf_packets, uint, 0444);
+MODULE_PARM_DESC(buf_packets, "TS packets per simulated DMA buffer "
+		 "(default 512)");
+
+static unsigned int loop_kb = 4096;
+module_param(loop_kb, uint, 0444);
+MODULE_PARM_DESC(loop_kb, "size of the looped stream per adapter in KiB "
+		 "(default 4096)");
+
+static unsigned int synth_pids = 16;
+module_param(synth_pids, uint, 0444);
+MODULE_PARM_DESC(synth_pids, "PIDs in the synthetic stream (0-"
+		 __stringify(DVBVIRT_MAX_SYNTH_PIDS) "), 0 starts without "
+		 "signal (default 16)");
+
+static char *ts_file;
+module_param(ts_file, charp, 0444);
+MODULE_PARM_DESC(ts_file, "TS file to play, loaded through the firmware "
+		 "loader");
+
+static unsigned int delsys;
+module_param(delsys, uint, 0444);
+MODULE_PARM_DESC(delsys, "dummy frontend type: 0=DVB-S, 1=DVB-T, 2=DVB-C");
+
+static unsigned int debug;
+module_param(debug, uint, 0644);
+MODULE_PARM_DESC(debug, "enable debug messages");
+
+#define dprintk(fmt, arg...) do {					\
+	if (debug)							\
+		printk(KERN_DEBUG DRIVER_NAME "%d: " fmt, va->nr, ##arg); \
+} while (0)
+
+struct dvbvirt_adapter {
+	int			nr;
+
+	struct dvb_adapter	adapter;
+	struct dvb_frontend	*fe;
+	struct dvb_demux	demux;
+	struct dmxdev		dmxdev;
+	struct dmx_frontend	hw_frontend;
+	struct dmx_frontend	mem_frontend;
+	struct dvb_net		dvbnet;
+
+	/* the signal: a stream played in a loop, protected by lock */
+	spinlock_t		lock;
+	u8			*loop;
+	size_t			loop_size;
+	size_t			loop_len;
+	size_t			loop_pos;
+	unsigned long		writer;
+
+	/* the "dma": hrtimer interrupt, tasklet bottom half */
+	struct hrtimer		timer;
+	ktime_t			period;
+	struct tasklet_struct	tasklet;
+	atomic_t		pending;
+	u8			*buf;
+	struct mutex		feed_lock;
+	int			nfeeds;
+
+	/* statistics, written by the tasklet only */
+	ktime_t			start;
+	u64			packets;
+	unsigned long		buffers;
+	unsigned long		late;
+	unsigned long		dropped;
+
+	struct miscdevice	misc;
+	char			misc_name[16];
+	struct dentry		*debugfs;
+};
+
+static struct platform_device *dvbvirt_pdev;
+static struct dvbvirt_adapter *dvbvirt[DVBVIRT_MAX_ADAPTERS];
+static struct dentry *dvbvirt_debugfs;
+
+/* ------------------------------------------------------------------ */
+
+/* copy the next buffer out of the loop, as the DMA engine would */
+static unsigned int dvbvirt_dma(struct dvbvirt_adapter *va)
+{
+	size_t size = buf_packets * DVBVIRT_TS_SIZE;
+	size_t done = 0, n;
+
+	spin_lock(&va->lock);
+	if (!va->loop_len) {
+		spin_unlock(&va->lock);
+		return 0;
+	}
+	while (done < size) {
+		if (va->loop_pos >= va->loop_len)
+			va->loop_pos = 0;
+		n = min(size - done, va->loop_len - va->loop_pos);
+		memcpy(va->buf + done, va->loop + va->loop_pos, n);
+		va->loop_pos += n;
+		done += n;
+	}
+	spin_unlock(&va->lock);
+
+	return buf_packets;
+}
+
+static void dvbvirt_tasklet(unsigned long data)
+{
+	struct dvbvirt_adapter *va = (struct dvbvirt_adapter *)data;
+	unsigned int count;
+	int n;
+
+	n = atomic_xchg(&va->pending, 0);
+	if (n > DVBVIRT_MAX_CATCHUP) {
+		va->dropped += n - DVBVIRT_MAX_CATCHUP;
+		n = DVBVIRT_MAX_CATCHUP;
+	}
+
+	while (n--) {
+		count = dvbvirt_dma(va);
+		if (!count)
+			break;
+		dvb_dmx_swfilter_packets(&va->demux, va->buf, count);
+		va->packets += count;
+		va->buffers++;
+	}
+}
+
+static enum hrtimer_restart dvbvirt_timer(struct hrtimer *timer)
+{
+	struct dvbvirt_adapter *va =
+		container_of(timer, struct dvbvirt_adapter, timer);
+	unsigned long ticks;
+
+	ticks = hrtimer_forward_now(timer, va->period);
+	if (ticks > 1)
+		va->late += ticks - 1;
+	atomic_add(ticks, &va->pending);
+	tasklet_schedule(&va->tasklet);
+
+	return HRTIMER_RESTART;
+}
+
+static int dvbvirt_start_feed(struct dvb_demux_feed *feed)
+{
+	struct dvbvirt_adapter *va = feed->demux->priv;
+	u64 bits = (u64)buf_packets * DVBVIRT_TS_SIZE * 8;
+
+	mutex_lock(&va->feed_lock);
+	if (va->nfeeds++ == 0) {
+		/* one buffer per tick at the requested rate */
+		va->period = ns_to_ktime(div_u64(bits * 1000000,
+						 max(bitrate, 1U)));
+		atomic_set(&va->pending, 0);
+		va->start = ktime_get();
+		hrtimer_start(&va->timer, va->period, HRTIMER_MODE_REL);
+		dprintk("streaming, %u packets every %lld ns\n", buf_packets,
+			(long long)ktime_to_ns(va->period));
+	}
+	mutex_unlock(&va->feed_lock);
+
+	return 0;
+}
+
+static int dvbvirt_stop_feed(struct dvb_demux_feed *feed)
+{
+	struct dvbvirt_adapter *va = feed->demux->priv;
+
+	mutex_lock(&va->feed_lock);
+	if (--va->nfeeds == 0) {
+		hrtimer_cancel(&va->timer);
+		tasklet_kill(&va->tasklet);
+		dprintk("stopped\n");
+	}
+	mutex_unlock(&va->feed_lock);
+
+	return 0;
+}
+
+/* ------------------------------------------------------------------ */
+
+/* every PID gets a multiple of 16 packets, so continuity survives the loop */
+static void dvbvirt_synth(struct dvbvirt_adapter *va)
+{
+	size_t packets = va->loop_size / DVBVIRT_TS_SIZE;
+	size_t i;
+	u8 *p;
+	u16 pid;
+
+	packets -= packets % (synth_pids * 16);
+	for (i = 0; i < packets; i++) {
+		p = va->loop + i * DVBVIRT_TS_SIZE;
+		pid = 0x100 + i % synth_pids;
+		p[0] = 0x47;
+		p[1] = pid >> 8;
+		p[2] = pid & 0xff;
+		p[3] = 0x10 | ((i / synth_pids) & 0x0f);
+		memset(p + 4, i & 0xff, DVBVIRT_TS_SIZE - 4);
+	}
+	va->loop_len = packets * DVBVIRT_TS_SIZE;
+}
+
+static int dvbvirt_load(struct dvbvirt_adapter *va)
+{
+	const struct firmware *fw;
+	size_t len;
+	int ret;
+
+	ret = request_firmware(&fw, ts_file, &dvbvirt_pdev->dev);
+	if (ret < 0) {
+		printk(KERN_ERR DRIVER_NAME ": could not load %s (%d)\n",
+		       ts_file, ret);
+		return ret;
+	}
+
+	len = min(fw->size, va->loop_size);
+	len -= len % DVBVIRT_TS_SIZE;
+	memcpy(va->loop, fw->data, len);
+	va->loop_len = len;
+	if (len < fw->size)
+		printk(KERN_INFO DRIVER_NAME "%d: playing %zu of %zu bytes "
+		       "of %s\n", va->nr, len, fw->size, ts_file);
+	release_firmware(fw);
+
+	return 0;
+}
+
+/*
+ * /dev/dvbvirtN: opening for writing empties the loop, the data written
+ * afterwards is played as it arrives. Writes must be whole packets.
+ */
+static struct dvbvirt_adapter *dvbvirt_find(int minor)
+{
+	int i;
+
+	for (i = 0; i < adapters; i++)
+		if (dvbvirt[i] && dvbvirt[i]->misc.minor == minor)
+			return dvbvirt[i];
+	return NULL;
+}
+
+static int dvbvirt_open(struct inode *inode, struct file *file)
+{
+	struct dvbvirt_adapter *va = dvbvirt_find(iminor(inode));
+
+	if (!va)
+		return -ENODEV;
+	if (!(file->f_mode & FMODE_WRITE))
+		return -EINVAL;
+	if (test_and_set_bit(0, &va->writer))
+		return -EBUSY;
+
+	spin_lock_bh(&va->lock);
+	va->loop_len = 0;
+	va->loop_pos = 0;
+	spin_unlock_bh(&va->lock);
+
+	file->private_data = va;
+	return 0;
+}
+
+static int dvbvirt_release(struct inode *inode, struct file *file)
+{
+	struct dvbvirt_adapter *va = file->private_data;
+
+	clear_bit(0, &va->writer);
+	return 0;
+}
+
+static ssize_t dvbvirt_write(struct file *file, const char __user *data,
+			     size_t count, loff_t *ppos)
+{
+	struct dvbvirt_adapter *va = file->private_data;
+	size_t done = 0, n, i;
+	ssize_t ret = 0;
+	u8 *chunk;
+
+	if (count % DVBVIRT_TS_SIZE)
+		return -EINVAL;
+
+	chunk = kmalloc(DVBVIRT_WRITE_CHUNK, GFP_KERNEL);
+	if (!chunk)
+		return -ENOMEM;
+
+	while (done < count) {
+		n = min_t(size_t, count - done, DVBVIRT_WRITE_CHUNK);
+		if (copy_from_user(chunk, data + done, n)) {
+			ret = -EFAULT;
+			break;
+		}
+		for (i = 0; i < n; i += DVBVIRT_TS_SIZE)
+			if (chunk[i] != 0x47)
+				break;
+		if (i < n) {
+			ret = -EINVAL;
+			break;
+		}
+
+		spin_lock_bh(&va->lock);
+		if (va->loop_len + n > va->loop_size) {
+			spin_unlock_bh(&va->lock);
+			ret = -ENOSPC;
+			break;
+		}
+		memcpy(va->loop + va->loop_len, chunk, n);
+		va->loop_len += n;
+		spin_unlock_bh(&va->lock);
+
+		done += n;
+	}
+	kfree(chunk);
+
+	return done ? done : ret;
+}
+
+static const struct file_operations dvbvirt_fops = {
+	.owner		= THIS_MODULE,
+	.open		= dvbvirt_open,
+	.release	= dvbvirt_release,
+	.write		= dvbvirt_write,
+};
+
+/* ------------------------------------------------------------------ */
+
+static int dvbvirt_debugfs_show(struct seq_file *s, void *unused)
+{
+	struct dvbvirt_adapter *va = s->private;
+	s64 us = ktime_to_us(ktime_sub(ktime_get(), va->start));
+	u64 kbits = va->packets * DVBVIRT_TS_SIZE * 8;
+
+	seq_printf(s, "bitrate:    %u kbit/s requested\n", bitrate);
+	seq_printf(s, "buffer:     %u packets\n", buf_packets);
+	seq_printf(s, "loop:       %zu of %zu bytes\n",
+		   va->loop_len, va->loop_size);
+	seq_printf(s, "feeds:      %d\n", va->nfeeds);
+	seq_printf(s, "buffers:    %lu\n", va->buffers);
+	seq_printf(s, "packets:    %llu\n", (unsigned long long)va->packets);
+	seq_printf(s, "late ticks: %lu\n", va->late);
+	seq_printf(s, "dropped:    %lu\n", va->dropped);
+	if (va->nfeeds && us > 0)
+		seq_printf(s, "rate:       %llu kbit/s\n",
+			   (unsigned long long)div64_u64(kbits * 1000, us));
+
+	return 0;
+}
+
+static int dvbvirt_debugfs_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, dvbvirt_debugfs_show, inode->i_private);
+}
+
+static const struct file_operations dvbvirt_debugfs_fops = {
+	.owner		= THIS_MODULE,
+	.open		= dvbvirt_debugfs_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+/* ------------------------------------------------------------------ */
+
+static int dvbvirt_frontend_init(struct dvbvirt_adapter *va)
+{
+	int ret;
+
+	switch (delsys) {
+	case 1:
+		va->fe = dvb_attach(dvb_dummy_fe_ofdm_attach);
+		break;
+	case 2:
+		va->fe = dvb_attach(dvb_dummy_fe_qam_attach);
+		break;
+	default:
+		va->fe = dvb_attach(dvb_dummy_fe_qpsk_attach);
+		break;
+	}
+	if (!va->fe) {
+		printk(KERN_ERR DRIVER_NAME "%d: could not attach frontend\n",
+		       va->nr);
+		return -ENODEV;
+	}
+
+	ret = dvb_register_frontend(&va->adapter, va->fe);
+	if (ret < 0) {
+		dvb_frontend_detach(va->fe);
+		va->fe = NULL;
+	}
+
+	return ret;
+}
+
+static int dvbvirt_adapter_init(struct dvbvirt_adapter *va)
+{
+	struct dvb_demux *dvbdemux = &va->demux;
+	struct dmx_demux *dmx = &dvbdemux->dmx;
+	int ret;
+
+	ret = dvb_register_adapter(&va->adapter, DRIVER_NAME, THIS_MODULE,
+				   &dvbvirt_pdev->dev, adapter_nr);
+	if (ret < 0)
+		return ret;
+
+	dvbdemux->priv = va;
+	dvbdemux->filternum = 256;
+	dvbdemux->feednum = 256;
+	dvbdemux->start_feed = dvbvirt_start_feed;
+	dvbdemux->stop_feed = dvbvirt_stop_feed;
+	dvbdemux->dmx.capabilities = (DMX_TS_FILTERING |
+			DMX_SECTION_FILTERING | DMX_MEMORY_BASED_FILTERING);
+	ret = dvb_dmx_init(dvbdemux);
+	if (ret < 0)
+		goto err_dvb_unregister_adapter;
+
+	va->hw_frontend.source = DMX_FRONTEND_0;
+	va->mem_frontend.source = DMX_MEMORY_FE;
+	va->dmxdev.filternum = 256;
+	va->dmxdev.demux = dmx;
+
+	ret = dvb_dmxdev_init(&va->dmxdev, &va->adapter);
+	if (ret < 0)
+		goto err_dvb_dmx_release;
+
+	ret = dmx->add_frontend(dmx, &va->hw_frontend);
+	if (ret < 0)
+		goto err_dvb_dmxdev_release;
+
+	ret = dmx->add_frontend(dmx, &va->mem_frontend);
+	if (ret < 0)
+		goto err_remove_hw_frontend;
+
+	ret = dmx->connect_frontend(dmx, &va->hw_frontend);
+	if (ret < 0)
+		goto err_remove_mem_frontend;
+
+	ret = dvbvirt_frontend_init(va);
+	if (ret < 0)
+		goto err_disconnect_frontend;
+
+	dvb_net_init(&va->adapter, &va->dvbnet, dmx);
+
+	snprintf(va->misc_name, sizeof(va->misc_name), DRIVER_NAME "%d",
+		 va->nr);
+	va->misc.minor = MISC_DYNAMIC_MINOR;
+	va->misc.name = va->misc_name;
+	va->misc.fops = &dvbvirt_fops;
+	ret = misc_register(&va->misc);
+	if (ret < 0)
+		goto err_release_net;
+
+	return 0;
+
+err_release_net:
+	dvb_net_release(&va->dvbnet);
+	dvb_unregister_frontend(va->fe);
+	dvb_frontend_detach(va->fe);
+err_disconnect_frontend:
+	dmx->disconnect_frontend(dmx);
+err_remove_mem_frontend:
+	dmx->remove_frontend(dmx, &va->mem_frontend);
+err_remove_hw_frontend:
+	dmx->remove_frontend(dmx, &va->hw_frontend);
+err_dvb_dmxdev_release:
+	dvb_dmxdev_release(&va->dmxdev);
+err_dvb_dmx_release:
+	dvb_dmx_release(dvbdemux);
+err_dvb_unregister_adapter:
+	dvb_unregister_adapter(&va->adapter);
+	return ret;
+}
+
+static void dvbvirt_adapter_exit(struct dvbvirt_adapter *va)
+{
+	struct dmx_demux *dmx = &va->demux.dmx;
+
+	misc_deregister(&va->misc);
+	dmx->close(dmx);
+	dvb_net_release(&va->dvbnet);
+	dvb_unregister_frontend(va->fe);
+	dvb_frontend_detach(va->fe);
+
+	dmx->disconnect_frontend(dmx);
+	dmx->remove_frontend(dmx, &va->mem_frontend);
+	dmx->remove_frontend(dmx, &va->hw_frontend);
+	dvb_dmxdev_release(&va->dmxdev);
+	dvb_dmx_release(&va->demux);
+	dvb_unregister_adapter(&va->adapter);
+
+	/* no feeds are left, but be sure the "dma" is idle */
+	hrtimer_cancel(&va->timer);
+	tasklet_kill(&va->tasklet);
+}
+
+static void dvbvirt_free(struct dvbvirt_adapter *va)
+{
+	vfree(va->loop);
+	kfree(va->buf);
+	kfree(va);
+}
+
+static struct dvbvirt_adapter *dvbvirt_alloc(int nr)
+{
+	struct dvbvirt_adapter *va;
+
+	va = kzalloc(sizeof(*va), GFP_KERNEL);
+	if (!va)
+		return NULL;
+
+	va->nr = nr;
+	spin_lock_init(&va->lock);
+	mutex_init(&va->feed_lock);
+	atomic_set(&va->pending, 0);
+	hrtimer_init(&va->timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	va->timer.function = dvbvirt_timer;
+	tasklet_init(&va->tasklet, dvbvirt_tasklet, (unsigned long)va);
+
+	va->loop_size = loop_kb * 1024;
+	va->loop_size -= va->loop_size % DVBVIRT_TS_SIZE;
+	va->loop = vmalloc(va->loop_size);
+	va->buf = kmalloc(buf_packets * DVBVIRT_TS_SIZE, GFP_KERNEL);
+	if (!va->loop || !va->buf) {
+		dvbvirt_free(va);
+		return NULL;
+	}
+
+	return va;
+}
+
+static void dvbvirt_cleanup(void)
+{
+	int i;
+
+	for (i = 0; i < DVBVIRT_MAX_ADAPTERS; i++) {
+		if (!dvbvirt[i])
+			continue;
+		dvbvirt_adapter_exit(dvbvirt[i]);
+		dvbvirt_free(dvbvirt[i]);
+		dvbvirt[i] = NULL;
+	}
+	if (!IS_ERR_OR_NULL(dvbvirt_debugfs))
+		debugfs_remove_recursive(dvbvirt_debugfs);
+	platform_device_unregister(dvbvirt_pdev);
+}
+
+static int __init dvbvirt_init(void)
+{
+	struct dvbvirt_adapter *va;
+	char name[16];
+	int i, ret;
+
+	if (!adapters || adapters > DVBVIRT_MAX_ADAPTERS ||
+	    !buf_packets || loop_kb * 1024 < buf_packets * DVBVIRT_TS_SIZE ||
+	    synth_pids > DVBVIRT_MAX_SYNTH_PIDS) {
+		printk(KERN_ERR DRIVER_NAME ": invalid adapters, buf_packets, "
+		       "loop_kb or synth_pids\n");
+		return -EINVAL;
+	}
+
+	dvbvirt_pdev = platform_device_register_simple(DRIVER_NAME, -1,
+						       NULL, 0);
+	if (IS_ERR(dvbvirt_pdev))
+		return PTR_ERR(dvbvirt_pdev);
+
+	dvbvirt_debugfs = debugfs_create_dir(DRIVER_NAME, NULL);
+
+	for (i = 0; i < adapters; i++) {
+		va = dvbvirt_alloc(i);
+		if (!va) {
+			ret = -ENOMEM;
+			goto err;
+		}
+
+		if (ts_file) {
+			ret = dvbvirt_load(va);
+			if (ret < 0) {
+				dvbvirt_free(va);
+				goto err;
+			}
+		} else if (synth_pids) {
+			dvbvirt_synth(va);
+		}
+
+		ret = dvbvirt_adapter_init(va);
+		if (ret < 0) {
+			dvbvirt_free(va);
+			goto err;
+		}
+		dvbvirt[i] = va;
+
+		if (!IS_ERR_OR_NULL(dvbvirt_debugfs)) {
+			snprintf(name, sizeof(name), "adapter%d", i);
+			va->debugfs = debugfs_create_file(name, S_IRUGO,
+					dvbvirt_debugfs, va,
+					&dvbvirt_debugfs_fops);
+		}
+	}
+
+	printk(KERN_INFO DRIVER_NAME ": %u adapter(s), %u kbit/s, "
+	       "%u packets per buffer\n", adapters, bitrate, buf_packets);
+	return 0;
+
+err:
+	dvbvirt_cleanup();
+	return ret;
+}
+
+static void __exit dvbvirt_exit(void)
+{
+	dvbvirt_cleanup();
+}
+
+module_init(dvbvirt_init);
+module_exit(dvbvirt_exit);
+
+MODULE_DESCRIPTION("Virtual DVB bridge playing a transport stream from memory");
+MODULE_LICENSE("GPL");
@@ -3514,6 +3514,18 @@ static enum dvbfe_search stv090x_search(struct dvb_frontend *fe, struct dvb_fron
 	return DVBFE_ALGO_SEARCH_ERROR;
 }
 
+static int stv090x_partial_tune(struct dvb_frontend *fe, unsigned int changed)
+{
+	struct stv090x_state *state = fe->demodulator_priv;
+	struct dtv_frontend_properties *props = &fe->dtv_property_cache;
+
+	/* MIS filtering is applied after demodulation, no need to search */
+	if (changed != DVBFE_CHANGED_STREAM_ID)
+		return -EINVAL;
+
+	return stv090x_set_mis(state, props->dvbt2_plp_id);
+}
+
 static int stv090x_read_status(struct dvb_frontend *fe, enum fe_status *status)
 {
 	struct stv090x_state *state = fe->demodulator_priv;
@@ -4906,6 +4918,9 @@ struct dvb_frontend *stv090x_attach(const struct stv090x_config *config,
 	}
 
 	state->frontend.ops.info.caps |= FE_CAN_MULTISTREAM;
+	/* without the hook a stream_id change falls back to a full retune */
+	if (dvb_frontend_set_partial_tune(&state->frontend, stv090x_partial_tune) < 0)
+		dprintk(FE_ERROR, 1, "Cannot register partial tune");
 
 	/* workaround for stuck DiSEqC output */
 	if (config->diseqc_envelope_mode)
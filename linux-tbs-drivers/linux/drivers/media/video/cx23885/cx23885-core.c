@@ -1175,15 +1175,10 @@ int cx23885_risc_buffer(struct pci_dev *pci, struct btcx_riscmem *risc,
 	return 0;
 }
 
-static int cx23885_risc_databuffer(struct pci_dev *pci,
-				   struct btcx_riscmem *risc,
-				   struct scatterlist *sglist,
-				   unsigned int bpl,
-				   unsigned int lines)
+unsigned int cx23885_risc_databuffer_size(unsigned int bpl,
+					  unsigned int lines)
 {
 	u32 instructions;
-	__le32 *rp;
-	int rc;
 
 	/* estimate risc mem: worst case is one write per page border +
 	   one write per scan line + syncs + jump (all 2 dwords).  Here
@@ -1193,7 +1188,20 @@ static int cx23885_risc_databuffer(struct pci_dev *pci,
 	instructions  = 1 + (bpl * lines) / PAGE_SIZE + lines;
 	instructions += 1;
 
-	rc = btcx_riscmem_alloc(pci, risc, instructions*12);
+	return instructions * 12;
+}
+
+int cx23885_risc_databuffer(struct pci_dev *pci,
+			    struct btcx_riscmem *risc,
+			    struct scatterlist *sglist,
+			    unsigned int bpl,
+			    unsigned int lines)
+{
+	__le32 *rp;
+	int rc;
+
+	rc = btcx_riscmem_alloc(pci, risc,
+				cx23885_risc_databuffer_size(bpl, lines));
 	if (rc < 0)
 		return rc;
 
@@ -1295,13 +1303,13 @@ static void cx23885_tsport_reg_dump(struct cx23885_tsport *port)
 
 static int cx23885_start_dma(struct cx23885_tsport *port,
 			     struct cx23885_dmaqueue *q,
-			     struct cx23885_buffer   *buf)
+			     struct btcx_riscmem     *risc)
 {
 	struct cx23885_dev *dev = port->dev;
 	u32 reg;
 
-	dprintk(1, "%s() w: %d, h: %d, f: %d\n", __func__,
-		buf->vb.width, buf->vb.height, buf->vb.field);
+	dprintk(1, "%s() w: %d, h: %d\n", __func__,
+		port->ts_packet_size, port->ts_packet_count);
 
 	/* Stop the fifo and risc engine for this port */
 	cx_clear(port->reg_dma_ctl, port->dma_ctl_val);
@@ -1309,15 +1317,15 @@ static int cx23885_start_dma(struct cx23885_tsport *port,
 	/* setup fifo + format */
 	cx23885_sram_channel_setup(dev,
 				   &dev->sram_channels[port->sram_chno],
-				   port->ts_packet_size, buf->risc.dma);
+				   port->ts_packet_size, risc->dma);
 	if (debug > 5) {
 		cx23885_sram_channel_dump(dev,
 			&dev->sram_channels[port->sram_chno]);
-		cx23885_risc_disasm(port, &buf->risc);
+		cx23885_risc_disasm(port, risc);
 	}
 
 	/* write TS length to chip */
-	cx_write(port->reg_lngth, buf->vb.width);
+	cx_write(port->reg_lngth, port->ts_packet_size);
 
 	if ((!(cx23885_boards[dev->board].portb & CX23885_MPEG_DVB)) &&
 		(!(cx23885_boards[dev->board].portc & CX23885_MPEG_DVB))) {
@@ -1456,7 +1464,7 @@ int cx23885_restart_queue(struct cx23885_tsport *port,
 			if (NULL == prev) {
 				list_del(&buf->vb.queue);
 				list_add_tail(&buf->vb.queue, &q->active);
-				cx23885_start_dma(port, q, buf);
+				cx23885_start_dma(port, q, &buf->risc);
 				buf->vb.state = VIDEOBUF_ACTIVE;
 				buf->count    = q->count++;
 				mod_timer(&q->timeout, jiffies+BUFFER_TIMEOUT);
@@ -1486,7 +1494,7 @@ int cx23885_restart_queue(struct cx23885_tsport *port,
 	buf = list_entry(q->active.next, struct cx23885_buffer, vb.queue);
 	dprintk(2, "restart_queue [%p/%d]: restart dma\n",
 		buf, buf->vb.i);
-	cx23885_start_dma(port, q, buf);
+	cx23885_start_dma(port, q, &buf->risc);
 	list_for_each_entry(buf, &q->active, vb.queue)
 		buf->count = q->count++;
 	mod_timer(&q->timeout, jiffies + BUFFER_TIMEOUT);
@@ -1541,7 +1549,7 @@ void cx23885_buf_queue(struct cx23885_tsport *port, struct cx23885_buffer *buf)
 	if (list_empty(&cx88q->active)) {
 		dprintk(1, "queue is empty - first active\n");
 		list_add_tail(&buf->vb.queue, &cx88q->active);
-		cx23885_start_dma(port, cx88q, buf);
+		cx23885_start_dma(port, cx88q, &buf->risc);
 		buf->vb.state = VIDEOBUF_ACTIVE;
 		buf->count    = cx88q->count++;
 		mod_timer(&cx88q->timeout, jiffies + BUFFER_TIMEOUT);
@@ -1561,6 +1569,118 @@ void cx23885_buf_queue(struct cx23885_tsport *port, struct cx23885_buffer *buf)
 	}
 }
 
+/* with interrupt moderation a completion is only seen every few buffers */
+static unsigned long cx23885_dvb_timeout(struct cx23885_tsport *port)
+{
+	return BUFFER_TIMEOUT * max(port->ts_irq_every, 1U) *
+		max(port->ts_packet_count / 32, 1U);
+}
+
+/*
+ * DVB ports use videobuf2 buffers. vb2 calls buf_queue without any driver
+ * lock held, so take the port lock here; completed buffers go back through
+ * vb2_dvb_buffer_done() and are requeued by the vb2-dvb work.
+ *
+ * Every buffer bumps the hardware counter but only every ts_irq_every'th
+ * one raises RISCI1; the wakeup completes all buffers the counter passed.
+ */
+void cx23885_dvb_buf_queue(struct cx23885_tsport *port,
+			   struct cx23885_dvb_buffer *buf)
+{
+	struct cx23885_dvb_buffer *prev;
+	struct cx23885_dev *dev = port->dev;
+	struct cx23885_dmaqueue *q = &port->mpegq;
+	unsigned long flags;
+	u32 jump = RISC_JUMP | RISC_CNT_INC;
+
+	spin_lock_irqsave(&port->slock, flags);
+	if (port->ts_irq_every <= 1 ||
+	    q->count % port->ts_irq_every == port->ts_irq_every - 1)
+		jump |= RISC_IRQ1;
+
+	/* add jump to stopper */
+	buf->risc.jmp[0] = cpu_to_le32(jump);
+	buf->risc.jmp[1] = cpu_to_le32(q->stopper.dma);
+	buf->risc.jmp[2] = cpu_to_le32(0); /* bits 63-32 */
+
+	if (list_empty(&q->active)) {
+		list_add_tail(&buf->queue, &q->active);
+		cx23885_start_dma(port, q, &buf->risc);
+		buf->count = q->count++;
+		mod_timer(&q->timeout, jiffies + cx23885_dvb_timeout(port));
+		dprintk(1, "[%p/%d] %s - first active\n",
+			buf, buf->vb.v4l2_buf.index, __func__);
+	} else {
+		prev = list_entry(q->active.prev, struct cx23885_dvb_buffer,
+				  queue);
+		list_add_tail(&buf->queue, &q->active);
+		buf->count = q->count++;
+		prev->risc.jmp[1] = cpu_to_le32(buf->risc.dma);
+		prev->risc.jmp[2] = cpu_to_le32(0); /* 64 bit bits 63-32 */
+		dprintk(2, "[%p/%d] %s - append to active\n",
+			buf, buf->vb.v4l2_buf.index, __func__);
+	}
+	spin_unlock_irqrestore(&port->slock, flags);
+}
+
+static void cx23885_dvb_wakeup(struct cx23885_tsport *port,
+			       struct cx23885_dmaqueue *q, u32 count)
+{
+	struct cx23885_dev *dev = port->dev;
+	struct cx23885_dvb_buffer *buf;
+
+	while (!list_empty(&q->active)) {
+		buf = list_entry(q->active.next, struct cx23885_dvb_buffer,
+				 queue);
+
+		/* same 16bit wrap-around trick as cx23885_wakeup() */
+		if ((s16) (count - buf->count) < 0)
+			break;
+
+		do_gettimeofday(&buf->vb.v4l2_buf.timestamp);
+		dprintk(2, "[%p/%d] wakeup reg=%d buf=%d\n", buf,
+			buf->vb.v4l2_buf.index, count, buf->count);
+		list_del(&buf->queue);
+		vb2_dvb_buffer_done(&buf->vb, VB2_BUF_STATE_DONE);
+	}
+	if (list_empty(&q->active))
+		del_timer(&q->timeout);
+	else
+		mod_timer(&q->timeout, jiffies + cx23885_dvb_timeout(port));
+}
+
+/*
+ * The risc program ran into the stopper before the vb2-dvb work appended
+ * the next buffer. Once cx23885_dvb_wakeup() has taken the filled ones off,
+ * everything left on the active list is unfilled, so restart from its head.
+ */
+static void cx23885_dvb_restart_queue(struct cx23885_tsport *port,
+				      struct cx23885_dmaqueue *q)
+{
+	struct cx23885_dev *dev = port->dev;
+	struct cx23885_dvb_buffer *buf;
+
+	if (list_empty(&q->active))
+		return;
+
+	buf = list_entry(q->active.next, struct cx23885_dvb_buffer, queue);
+	dprintk(2, "restart_queue [%p/%d]: restart dma\n",
+		buf, buf->vb.v4l2_buf.index);
+	cx23885_start_dma(port, q, &buf->risc);
+	list_for_each_entry(buf, &q->active, queue)
+		buf->count = q->count++;
+	mod_timer(&q->timeout, jiffies + cx23885_dvb_timeout(port));
+}
+
+static int cx23885_tsport_is_dvb(struct cx23885_tsport *port)
+{
+	struct cx23885_board *board = &cx23885_boards[port->dev->board];
+
+	if (port->nr == 1)
+		return board->portb == CX23885_MPEG_DVB;
+	return board->portc == CX23885_MPEG_DVB;
+}
+
 /* ----------------------------------------------------------- */
 
 static void do_cancel_buffers(struct cx23885_tsport *port, char *reason,
@@ -1569,9 +1689,24 @@ static void do_cancel_buffers(struct cx23885_tsport *port, char *reason,
 	struct cx23885_dev *dev = port->dev;
 	struct cx23885_dmaqueue *q = &port->mpegq;
 	struct cx23885_buffer *buf;
+	struct cx23885_dvb_buffer *dvb_buf;
 	unsigned long flags;
 
 	spin_lock_irqsave(&port->slock, flags);
+	if (cx23885_tsport_is_dvb(port)) {
+		/* vb2-dvb requeues these, which restarts the dma */
+		while (!list_empty(&q->active)) {
+			dvb_buf = list_entry(q->active.next,
+					     struct cx23885_dvb_buffer, queue);
+			list_del(&dvb_buf->queue);
+			vb2_dvb_buffer_done(&dvb_buf->vb, VB2_BUF_STATE_ERROR);
+			dprintk(1, "[%p/%d] %s - dma=0x%08lx\n", dvb_buf,
+				dvb_buf->vb.v4l2_buf.index, reason,
+				(unsigned long)dvb_buf->risc.dma);
+		}
+		spin_unlock_irqrestore(&port->slock, flags);
+		return;
+	}
 	while (!list_empty(&q->active)) {
 		buf = list_entry(q->active.next, struct cx23885_buffer,
 				 vb.queue);
@@ -1714,15 +1849,22 @@ static int cx23885_irq_ts(struct cx23885_tsport *port, u32 status)
 
 		spin_lock(&port->slock);
 		count = cx_read(port->reg_gpcnt);
-		cx23885_wakeup(port, &port->mpegq, count);
+		cx23885_dvb_wakeup(port, &port->mpegq, count);
+		/* the last buffer completing and the stopper can share
+		 * one interrupt when the requeue came in late */
+		if (status & VID_BC_MSK_RISCI2)
+			cx23885_dvb_restart_queue(port, &port->mpegq);
 		spin_unlock(&port->slock);
 
 	} else if (status & VID_BC_MSK_RISCI2) {
 
 		dprintk(7, " (RISCI2            0x%08x)\n", VID_BC_MSK_RISCI2);
 
+		/* buffers without RISC_IRQ1 may have completed unnoticed */
 		spin_lock(&port->slock);
-		cx23885_restart_queue(port, &port->mpegq);
+		count = cx_read(port->reg_gpcnt);
+		cx23885_dvb_wakeup(port, &port->mpegq, count);
+		cx23885_dvb_restart_queue(port, &port->mpegq);
 		spin_unlock(&port->slock);
 
 	}
@@ -85,51 +85,158 @@ MODULE_PARM_DESC(alt_tuner, "Enable alternate tuner configuration");
 
 DVB_DEFINE_MOD_OPT_ADAPTER_NR(adapter_nr);
 
+/* TS buffer geometry per port (B, C), picked up on the next feed start */
+static unsigned int ts_packets[2] = { 128, 128 };
+module_param_array(ts_packets, uint, NULL, 0644);
+MODULE_PARM_DESC(ts_packets, "TS packets per DVB buffer on port B,C "
+		 "(multiple of 4, default 128)");
+
+static unsigned int ts_bufs[2] = { 32, 32 };
+module_param_array(ts_bufs, uint, NULL, 0644);
+MODULE_PARM_DESC(ts_bufs, "DVB buffers queued on port B,C "
+		 "(2-" __stringify(VIDEO_MAX_FRAME) ", default 32)");
+
+static unsigned int ts_irq_every[2] = { 1, 1 };
+module_param_array(ts_irq_every, uint, NULL, 0644);
+MODULE_PARM_DESC(ts_irq_every, "interrupt once per this many DVB buffers on "
+		 "port B,C (at most half of ts_bufs, default 1)");
+
 /* ------------------------------------------------------------------ */
 
-static int dvb_buf_setup(struct videobuf_queue *q,
-			 unsigned int *count, unsigned int *size)
+static int dvb_queue_setup(struct vb2_queue *q,
+			   unsigned int *num_buffers, unsigned int *num_planes,
+			   unsigned long sizes[], void *alloc_ctxs[])
 {
-	struct cx23885_tsport *port = q->priv_data;
+	struct cx23885_tsport *port = vb2_get_drv_priv(q);
+	struct cx23885_dev *dev = port->dev;
+	unsigned int i = port->nr - 1;
+	unsigned int lines = ts_packets[i] / 4;
+	unsigned int bufs = ts_bufs[i];
+	unsigned int every = ts_irq_every[i];
 
+	/* each risc write moves one line of 4 packets */
 	port->ts_packet_size  = 188 * 4;
-	port->ts_packet_count = 32;
 
-	*size  = port->ts_packet_size * port->ts_packet_count;
-	*count = 32;
+	/* keep the risc program of each buffer within a single page */
+	if (!lines || ts_packets[i] % 4 ||
+	    cx23885_risc_databuffer_size(port->ts_packet_size, lines) >
+	    PAGE_SIZE) {
+		printk(KERN_WARNING "%s: ts_packets %u invalid for port %d, "
+		       "using 128\n", dev->name, ts_packets[i], port->nr);
+		lines = 32;
+	}
+	if (bufs < 2 || bufs > VIDEO_MAX_FRAME) {
+		printk(KERN_WARNING "%s: ts_bufs %u invalid for port %d, "
+		       "using 32\n", dev->name, bufs, port->nr);
+		bufs = 32;
+	}
+	/* the queue must not run dry between two interrupts */
+	if (!every || every > bufs / 2) {
+		printk(KERN_WARNING "%s: ts_irq_every %u invalid for port %d, "
+		       "using 1\n", dev->name, every, port->nr);
+		every = 1;
+	}
+
+	port->ts_packet_count = lines;
+	port->ts_irq_every    = every;
+
+	*num_planes = 1;
+	sizes[0] = port->ts_packet_size * port->ts_packet_count;
+	*num_buffers = bufs;
+	return 0;
+}
+
+/* the dma-sg allocator leaves the mapping to us, keep it for the
+ * lifetime of the buffer together with its risc program */
+static int dvb_buf_init(struct vb2_buffer *vb)
+{
+	struct cx23885_tsport *port = vb2_get_drv_priv(vb->vb2_queue);
+	struct cx23885_dev *dev = port->dev;
+	struct cx23885_dvb_buffer *buf =
+		container_of(vb, struct cx23885_dvb_buffer, vb);
+	struct vb2_dma_sg_desc *sg = vb2_dma_sg_plane_desc(vb, 0);
+	int rc;
+
+	if (!dma_map_sg(&dev->pci->dev, sg->sglist, sg->num_pages,
+			DMA_FROM_DEVICE))
+		return -EIO;
+
+	rc = cx23885_risc_databuffer(dev->pci, &buf->risc, sg->sglist,
+				     port->ts_packet_size,
+				     port->ts_packet_count);
+	if (rc < 0)
+		dma_unmap_sg(&dev->pci->dev, sg->sglist, sg->num_pages,
+			     DMA_FROM_DEVICE);
+	return rc;
+}
+
+static int dvb_buf_prepare(struct vb2_buffer *vb)
+{
+	struct cx23885_tsport *port = vb2_get_drv_priv(vb->vb2_queue);
+	struct cx23885_dev *dev = port->dev;
+	struct vb2_dma_sg_desc *sg = vb2_dma_sg_plane_desc(vb, 0);
+	unsigned long size = port->ts_packet_size * port->ts_packet_count;
+
+	if (vb2_plane_size(vb, 0) < size)
+		return -EINVAL;
+	vb2_set_plane_payload(vb, 0, size);
+
+	dma_sync_sg_for_device(&dev->pci->dev, sg->sglist, sg->num_pages,
+			       DMA_FROM_DEVICE);
 	return 0;
 }
 
-static int dvb_buf_prepare(struct videobuf_queue *q,
-			   struct videobuf_buffer *vb, enum v4l2_field field)
+static int dvb_buf_finish(struct vb2_buffer *vb)
 {
-	struct cx23885_tsport *port = q->priv_data;
-	return cx23885_buf_prepare(q, port, (struct cx23885_buffer *)vb, field);
+	struct cx23885_tsport *port = vb2_get_drv_priv(vb->vb2_queue);
+	struct cx23885_dev *dev = port->dev;
+	struct vb2_dma_sg_desc *sg = vb2_dma_sg_plane_desc(vb, 0);
+
+	dma_sync_sg_for_cpu(&dev->pci->dev, sg->sglist, sg->num_pages,
+			    DMA_FROM_DEVICE);
+	return 0;
 }
 
-static void dvb_buf_queue(struct videobuf_queue *q, struct videobuf_buffer *vb)
+static void dvb_buf_cleanup(struct vb2_buffer *vb)
 {
-	struct cx23885_tsport *port = q->priv_data;
-	cx23885_buf_queue(port, (struct cx23885_buffer *)vb);
+	struct cx23885_tsport *port = vb2_get_drv_priv(vb->vb2_queue);
+	struct cx23885_dev *dev = port->dev;
+	struct cx23885_dvb_buffer *buf =
+		container_of(vb, struct cx23885_dvb_buffer, vb);
+	struct vb2_dma_sg_desc *sg = vb2_dma_sg_plane_desc(vb, 0);
+
+	dma_unmap_sg(&dev->pci->dev, sg->sglist, sg->num_pages,
+		     DMA_FROM_DEVICE);
+	btcx_riscmem_free(dev->pci, &buf->risc);
 }
 
-static void dvb_buf_release(struct videobuf_queue *q,
-			    struct videobuf_buffer *vb)
+static void dvb_buf_queue(struct vb2_buffer *vb)
 {
-	cx23885_free_buffer(q, (struct cx23885_buffer *)vb);
+	struct cx23885_tsport *port = vb2_get_drv_priv(vb->vb2_queue);
+
+	cx23885_dvb_buf_queue(port,
+		container_of(vb, struct cx23885_dvb_buffer, vb));
+}
+
+static int dvb_stop_streaming(struct vb2_queue *q)
+{
+	struct cx23885_tsport *port = vb2_get_drv_priv(q);
+
+	cx23885_cancel_buffers(port);
+	return 0;
 }
 
 static void cx23885_dvb_gate_ctrl(struct cx23885_tsport  *port, int open)
 {
-	struct videobuf_dvb_frontends *f;
-	struct videobuf_dvb_frontend *fe;
+	struct vb2_dvb_frontends *f;
+	struct vb2_dvb_frontend *fe;
 
 	f = &port->frontends;
 
 	if (f->gate <= 1) /* undefined or fe0 */
-		fe = videobuf_dvb_get_frontend(f, 1);
+		fe = vb2_dvb_get_frontend(f, 1);
 	else
-		fe = videobuf_dvb_get_frontend(f, f->gate);
+		fe = vb2_dvb_get_frontend(f, f->gate);
 
 	if (fe && fe->dvb.frontend && fe->dvb.frontend->ops.i2c_gate_ctrl)
 		fe->dvb.frontend->ops.i2c_gate_ctrl(fe->dvb.frontend, open);
@@ -147,11 +254,14 @@ int cx23885ctrl2(struct cx23885_dev *dev, int a, int b)
 	return 0;
 }
 
-static struct videobuf_queue_ops dvb_qops = {
-	.buf_setup    = dvb_buf_setup,
-	.buf_prepare  = dvb_buf_prepare,
-	.buf_queue    = dvb_buf_queue,
-	.buf_release  = dvb_buf_release,
+static struct vb2_ops dvb_qops = {
+	.queue_setup    = dvb_queue_setup,
+	.buf_init       = dvb_buf_init,
+	.buf_prepare    = dvb_buf_prepare,
+	.buf_finish     = dvb_buf_finish,
+	.buf_cleanup    = dvb_buf_cleanup,
+	.buf_queue      = dvb_buf_queue,
+	.stop_streaming = dvb_stop_streaming,
 };
 
 static struct s5h1409_config hauppauge_generic_config = {
@@ -739,18 +849,18 @@ static int dvb_register(struct cx23885_tsport *port)
 {
 	struct cx23885_dev *dev = port->dev;
 	struct cx23885_i2c *i2c_bus = NULL, *i2c_bus2 = NULL;
-	struct videobuf_dvb_frontend *fe0, *fe1 = NULL;
+	struct vb2_dvb_frontend *fe0, *fe1 = NULL;
 	int mfe_shared = 0; /* bus not shared by default */
 	int ret;
 	
 	struct tbs6925cctrl_dev *ctl;
 
 	/* Get the first frontend */
-	fe0 = videobuf_dvb_get_frontend(&port->frontends, 1);
+	fe0 = vb2_dvb_get_frontend(&port->frontends, 1);
 	if (!fe0)
 		return -EINVAL;
 
-	/* init struct videobuf_dvb */
+	/* init struct vb2_dvb */
 	fe0->dvb.name = dev->name;
 
 	/* multi-frontend gate control is undefined or defaults to fe0 */
@@ -1238,7 +1348,7 @@ static int dvb_register(struct cx23885_tsport *port)
 			fe0->dvb.frontend->ops.tuner_ops.init(fe0->dvb.frontend);
 		}
 		/* MFE frontend 2 */
-		fe1 = videobuf_dvb_get_frontend(&port->frontends, 2);
+		fe1 = vb2_dvb_get_frontend(&port->frontends, 2);
 		if (fe1 == NULL)
 			goto frontend_detach;
 		/* DVB-C init */
@@ -1285,7 +1395,7 @@ static int dvb_register(struct cx23885_tsport *port)
 		fe0->dvb.frontend->ops.analog_ops.standby(fe0->dvb.frontend);
 
 	/* register everything */
-	ret = videobuf_dvb_register_bus(&port->frontends, THIS_MODULE, port,
+	ret = vb2_dvb_register_bus(&port->frontends, THIS_MODULE, port,
 					&dev->pci->dev, adapter_nr, mfe_shared,
 					cx23885_dvb_fe_ioctl_override);
 	if (ret)
@@ -1369,14 +1479,15 @@ static int dvb_register(struct cx23885_tsport *port)
 
 frontend_detach:
 	port->gate_ctrl = NULL;
-	videobuf_dvb_dealloc_frontends(&port->frontends);
+	vb2_dvb_dealloc_frontends(&port->frontends);
 	return -EINVAL;
 }
 
 int cx23885_dvb_register(struct cx23885_tsport *port)
 {
 
-	struct videobuf_dvb_frontend *fe0;
+	struct vb2_dvb_frontend *fe0;
+	struct vb2_queue *q;
 	struct cx23885_dev *dev = port->dev;
 	int err, i;
 
@@ -1393,13 +1504,13 @@ int cx23885_dvb_register(struct cx23885_tsport *port)
 		port->num_frontends);
 
 	for (i = 1; i <= port->num_frontends; i++) {
-		if (videobuf_dvb_alloc_frontend(
+		if (vb2_dvb_alloc_frontend(
 			&port->frontends, i) == NULL) {
 			printk(KERN_ERR "%s() failed to alloc\n", __func__);
 			return -ENOMEM;
 		}
 
-		fe0 = videobuf_dvb_get_frontend(&port->frontends, i);
+		fe0 = vb2_dvb_get_frontend(&port->frontends, i);
 		if (!fe0)
 			err = -EINVAL;
 
@@ -1415,10 +1526,18 @@ int cx23885_dvb_register(struct cx23885_tsport *port)
 		/* dvb stuff */
 		/* We have to init the queue for each frontend on a port. */
 		printk(KERN_INFO "%s: cx23885 based dvb card\n", dev->name);
-		videobuf_queue_sg_init(&fe0->dvb.dvbq, &dvb_qops,
-			    &dev->pci->dev, &port->slock,
-			    V4L2_BUF_TYPE_VIDEO_CAPTURE, V4L2_FIELD_TOP,
-			    sizeof(struct cx23885_buffer), port, NULL);
+		q = &fe0->dvb.dvbq;
+		q->type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+		q->io_modes = VB2_MMAP;
+		q->drv_priv = port;
+		q->buf_struct_size = sizeof(struct cx23885_dvb_buffer);
+		q->ops = &dvb_qops;
+		q->mem_ops = &vb2_dma_sg_memops;
+		err = vb2_queue_init(q);
+		if (err < 0)
+			return err;
+		/* the TS port DMAs lines of whole packets */
+		fe0->dvb.aligned = 1;
 	}
 	err = dvb_register(port);
 	if (err != 0)
@@ -1430,7 +1549,7 @@ int cx23885_dvb_register(struct cx23885_tsport *port)
 
 int cx23885_dvb_unregister(struct cx23885_tsport *port)
 {
-	struct videobuf_dvb_frontend *fe0;
+	struct vb2_dvb_frontend *fe0;
 
 	/* FIXME: in an error condition where the we have
 	 * an expected number of frontends (attach problem)
@@ -1439,9 +1558,9 @@ int cx23885_dvb_unregister(struct cx23885_tsport *port)
 	 * This comment only applies to future boards IF they
 	 * implement MFE support.
 	 */
-	fe0 = videobuf_dvb_get_frontend(&port->frontends, 1);
+	fe0 = vb2_dvb_get_frontend(&port->frontends, 1);
 	if (fe0 && fe0->dvb.frontend)
-		videobuf_dvb_unregister_bus(&port->frontends);
+		vb2_dvb_unregister_bus(&port->frontends);
 
 	switch (port->dev->board) {
 	case CX23885_BOARD_NETUP_DUAL_DVBS2_CI:
@@ -32,7 +32,8 @@
 #include <media/tuner.h>
 #include <media/tveeprom.h>
 #include <media/videobuf-dma-sg.h>
-#include <media/videobuf-dvb.h>
+#include <media/videobuf2-dma-sg.h>
+#include <media/videobuf2-dvb.h>
 #include <media/rc-core.h>
 
 #include "btcx-risc.h"
@@ -196,6 +197,17 @@ struct cx23885_buffer {
 	u32                    count;
 };
 
+/* buffer for a block of transport stream packets on a DVB port */
+struct cx23885_dvb_buffer {
+	/* common vb2 buffer stuff -- must be first */
+	struct vb2_buffer      vb;
+	struct list_head       queue;
+
+	/* cx23885 specific */
+	struct btcx_riscmem    risc;
+	u32                    count;
+};
+
 struct cx23885_input {
 	enum cx23885_itype type;
 	unsigned int    vmux;
@@ -273,12 +285,14 @@ struct cx23885_tsport {
 	int                        nr;
 	int                        sram_chno;
 
-	struct videobuf_dvb_frontends frontends;
+	struct vb2_dvb_frontends   frontends;
 
 	/* dma queues */
 	struct cx23885_dmaqueue    mpegq;
 	u32                        ts_packet_size;
 	u32                        ts_packet_count;
+	/* DVB ports: raise RISCI1 only every this many buffers */
+	u32                        ts_irq_every;
 
 	int                        width;
 	int                        height;
@@ -485,6 +499,12 @@ extern int cx23885_risc_buffer(struct pci_dev *pci, struct btcx_riscmem *risc,
 	unsigned int top_offset, unsigned int bottom_offset,
 	unsigned int bpl, unsigned int padding, unsigned int lines);
 
+extern unsigned int cx23885_risc_databuffer_size(unsigned int bpl,
+	unsigned int lines);
+extern int cx23885_risc_databuffer(struct pci_dev *pci,
+	struct btcx_riscmem *risc, struct scatterlist *sglist,
+	unsigned int bpl, unsigned int lines);
+
 void cx23885_cancel_buffers(struct cx23885_tsport *port);
 
 extern int cx23885_restart_queue(struct cx23885_tsport *port,
@@ -533,6 +553,8 @@ extern void cx23885_buf_queue(struct cx23885_tsport *port,
 			      struct cx23885_buffer *buf);
 extern void cx23885_free_buffer(struct videobuf_queue *q,
 				struct cx23885_buffer *buf);
+extern void cx23885_dvb_buf_queue(struct cx23885_tsport *port,
+				  struct cx23885_dvb_buffer *buf);
 
 /* ----------------------------------------------------------- */
 /* cx23885-video.c                                             */
@@ -1746,6 +1746,7 @@ static int cx8802_dvb_probe(struct cx8802_driver *drv)
 				    dev, NULL);
 		/* init struct videobuf_dvb */
 		fe->dvb.name = dev->core->name;
+		fe->dvb.aligned = 1;
 	}
 
 	err = dvb_register(dev);
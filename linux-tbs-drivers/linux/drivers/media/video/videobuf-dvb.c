@@ -40,6 +40,31 @@ MODULE_PARM_DESC(debug,"enable debug messages");
 
 /* ------------------------------------------------------------------ */
 
+/*
+ * Bridges which DMA whole packets into each buffer set dvb->aligned and get
+ * the demux without resync and carry-over. A buffer without a sync byte
+ * at every packet start goes through dvb_dmx_swfilter(), and so does
+ * everything until that has no partial packet pending any more.
+ */
+static void videobuf_dvb_feed(struct videobuf_dvb *dvb, const u8 *buf,
+			      size_t size)
+{
+	size_t i;
+
+	if (dvb->aligned && size % 188 == 0 && !dvb->demux.tsbufp) {
+		for (i = 0; i < size; i += 188)
+			if (buf[i] != 0x47)
+				break;
+		if (i == size) {
+			dvb_dmx_swfilter_packets(&dvb->demux, buf, size / 188);
+			return;
+		}
+		dvb->unaligned++;
+		dprintk("no sync byte at offset %zu, resyncing\n", i);
+	}
+	dvb_dmx_swfilter(&dvb->demux, buf, size);
+}
+
 static int videobuf_dvb_thread(void *data)
 {
 	struct videobuf_dvb *dvb = data;
@@ -69,8 +94,7 @@ static int videobuf_dvb_thread(void *data)
 		outp = videobuf_queue_to_vaddr(&dvb->dvbq, buf);
 
 		if (buf->state == VIDEOBUF_DONE)
-			dvb_dmx_swfilter(&dvb->demux, outp,
-					 buf->size);
+			videobuf_dvb_feed(dvb, outp, buf->size);
 
 		/* requeue buffer */
 		list_add_tail(&buf->stream,&dvb->dvbq.stream);
@@ -0,0 +1,505 @@
+/*
+ *
+ * helper functions for simple DVB cards which DMA the complete transport
+ * stream into videobuf2 buffers and let the software demux sort everything
+ * else. Modelled after videobuf-dvb.
+ *
+ * Buffers are not handed to a per-adapter kthread one by one. The bridge
+ * completes them with vb2_dvb_buffer_done() from its interrupt handler,
+ * which schedules a work item; the work then dequeues, demuxes and requeues
+ * everything that completed since it last ran.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/device.h>
+#include <linux/fs.h>
+#include <linux/slab.h>
+#include <linux/workqueue.h>
+
+#include <media/videobuf2-core.h>
+#include <media/videobuf2-dvb.h>
+
+/* ------------------------------------------------------------------ */
+
+MODULE_DESCRIPTION("videobuf2 based software demux feeding for DVB bridges");
+MODULE_LICENSE("GPL");
+
+static unsigned int debug;
+module_param(debug, int, 0644);
+MODULE_PARM_DESC(debug, "enable debug messages");
+
+#define dprintk(fmt, arg...)	if (debug)			\
+	printk(KERN_DEBUG "%s/dvb: " fmt, dvb->name , ## arg)
+
+/* ------------------------------------------------------------------ */
+
+/* same rules as videobuf_dvb_feed() */
+static void vb2_dvb_feed(struct vb2_dvb *dvb, const u8 *buf, size_t size)
+{
+	size_t i;
+
+	if (dvb->aligned && size % 188 == 0 && !dvb->demux.tsbufp) {
+		for (i = 0; i < size; i += 188)
+			if (buf[i] != 0x47)
+				break;
+		if (i == size) {
+			dvb_dmx_swfilter_packets(&dvb->demux, buf, size / 188);
+			return;
+		}
+		dvb->unaligned++;
+		dprintk("no sync byte at offset %zu, resyncing\n", i);
+	}
+	dvb_dmx_swfilter(&dvb->demux, buf, size);
+}
+
+static void vb2_dvb_work(struct work_struct *work)
+{
+	struct vb2_dvb *dvb = container_of(work, struct vb2_dvb, work);
+	struct vb2_buffer *vb;
+	struct v4l2_buffer b;
+	unsigned int batch = 0;
+
+	mutex_lock(&dvb->lock);
+	while (dvb->streaming) {
+		memset(&b, 0, sizeof(b));
+		b.type   = dvb->dvbq.type;
+		b.memory = V4L2_MEMORY_MMAP;
+		if (vb2_dqbuf(&dvb->dvbq, &b, true) < 0)
+			break;
+
+		vb = dvb->dvbq.bufs[b.index];
+		if (!(b.flags & V4L2_BUF_FLAG_ERROR))
+			vb2_dvb_feed(dvb, vb2_plane_vaddr(vb, 0),
+				     vb2_get_plane_payload(vb, 0));
+		batch++;
+
+		if (vb2_qbuf(&dvb->dvbq, &b) < 0) {
+			printk(KERN_WARNING "%s/dvb: requeue of buffer %d failed\n",
+			       dvb->name, b.index);
+			break;
+		}
+	}
+	if (batch) {
+		dvb->wakeups++;
+		dvb->buffers += batch;
+		if (batch > dvb->max_batch)
+			dvb->max_batch = batch;
+	}
+	mutex_unlock(&dvb->lock);
+}
+
+void vb2_dvb_buffer_done(struct vb2_buffer *vb, enum vb2_buffer_state state)
+{
+	struct vb2_dvb *dvb = container_of(vb->vb2_queue, struct vb2_dvb, dvbq);
+
+	vb2_buffer_done(vb, state);
+	/* no-op while the work is still pending, so bursts share one run */
+	schedule_work(&dvb->work);
+}
+EXPORT_SYMBOL(vb2_dvb_buffer_done);
+
+/*
+ * Buffers stay allocated between feeds, retuning is frequent. Ask the
+ * driver again and start over if its queue_setup() answer changed, so
+ * bridges with tunable buffer geometry pick it up on the next feed.
+ */
+static int vb2_dvb_geometry_changed(struct vb2_dvb *dvb)
+{
+	struct vb2_queue *q = &dvb->dvbq;
+	unsigned long sizes[VIDEO_MAX_PLANES];
+	void *alloc_ctxs[VIDEO_MAX_PLANES];
+	unsigned int num_buffers, num_planes = 0;
+
+	if (!q->num_buffers)
+		return 0;
+
+	memset(sizes, 0, sizeof(sizes));
+	num_buffers = dvb->nbufs ? dvb->nbufs : VIDEO_MAX_FRAME;
+	if (q->ops->queue_setup(q, &num_buffers, &num_planes, sizes,
+				alloc_ctxs))
+		return 0;
+
+	return num_buffers != q->num_buffers ||
+	       sizes[0] != vb2_plane_size(q->bufs[0], 0);
+}
+
+/* called with dvb->lock held */
+static int vb2_dvb_start(struct vb2_dvb *dvb)
+{
+	struct v4l2_requestbuffers req;
+	struct v4l2_buffer b;
+	unsigned int i;
+	int err;
+
+	if (vb2_dvb_geometry_changed(dvb)) {
+		memset(&req, 0, sizeof(req));
+		req.type   = dvb->dvbq.type;
+		req.memory = V4L2_MEMORY_MMAP;
+		err = vb2_reqbufs(&dvb->dvbq, &req);
+		if (err < 0)
+			return err;
+		dprintk("buffer geometry changed, reallocating\n");
+	}
+
+	if (!dvb->dvbq.num_buffers) {
+		memset(&req, 0, sizeof(req));
+		req.count  = dvb->nbufs ? dvb->nbufs : VIDEO_MAX_FRAME;
+		req.type   = dvb->dvbq.type;
+		req.memory = V4L2_MEMORY_MMAP;
+		err = vb2_reqbufs(&dvb->dvbq, &req);
+		if (err < 0)
+			return err;
+		dprintk("allocated %u buffers\n", dvb->dvbq.num_buffers);
+	}
+
+	for (i = 0; i < dvb->dvbq.num_buffers; i++) {
+		memset(&b, 0, sizeof(b));
+		b.index  = i;
+		b.type   = dvb->dvbq.type;
+		b.memory = V4L2_MEMORY_MMAP;
+		err = vb2_qbuf(&dvb->dvbq, &b);
+		if (err < 0)
+			goto fail;
+	}
+
+	err = vb2_streamon(&dvb->dvbq, dvb->dvbq.type);
+	if (err < 0)
+		goto fail;
+
+	dvb->streaming = 1;
+	return 0;
+
+fail:
+	/* drop the half queued set, the next start allocates afresh */
+	memset(&req, 0, sizeof(req));
+	req.type   = dvb->dvbq.type;
+	req.memory = V4L2_MEMORY_MMAP;
+	vb2_reqbufs(&dvb->dvbq, &req);
+	return err;
+}
+
+/* called with dvb->lock held */
+static void vb2_dvb_stop(struct vb2_dvb *dvb)
+{
+	dvb->streaming = 0;
+	vb2_streamoff(&dvb->dvbq, dvb->dvbq.type);
+	dprintk("%lu buffers in %lu runs, at most %u per run\n",
+		dvb->buffers, dvb->wakeups, dvb->max_batch);
+}
+
+static int vb2_dvb_start_feed(struct dvb_demux_feed *feed)
+{
+	struct dvb_demux *demux  = feed->demux;
+	struct vb2_dvb *dvb = demux->priv;
+	int rc;
+
+	if (!demux->dmx.frontend)
+		return -EINVAL;
+
+	mutex_lock(&dvb->lock);
+	if (!dvb->streaming) {
+		rc = vb2_dvb_start(dvb);
+		if (rc < 0)
+			goto out;
+	}
+	dvb->nfeeds++;
+	rc = dvb->nfeeds;
+
+out:
+	mutex_unlock(&dvb->lock);
+	return rc;
+}
+
+static int vb2_dvb_stop_feed(struct dvb_demux_feed *feed)
+{
+	struct dvb_demux *demux  = feed->demux;
+	struct vb2_dvb *dvb = demux->priv;
+
+	mutex_lock(&dvb->lock);
+	dvb->nfeeds--;
+	if (0 == dvb->nfeeds && dvb->streaming)
+		vb2_dvb_stop(dvb);
+	mutex_unlock(&dvb->lock);
+	return 0;
+}
+
+static int vb2_dvb_register_adapter(struct vb2_dvb_frontends *fe,
+			  struct module *module,
+			  void *adapter_priv,
+			  struct device *device,
+			  char *adapter_name,
+			  short *adapter_nr,
+			  int mfe_shared,
+			  int (*fe_ioctl_override)(struct dvb_frontend *,
+					unsigned int, void *, unsigned int))
+{
+	int result;
+
+	mutex_init(&fe->lock);
+
+	/* register adapter */
+	result = dvb_register_adapter(&fe->adapter, adapter_name, module,
+		device, adapter_nr);
+	if (result < 0) {
+		printk(KERN_WARNING "%s: dvb_register_adapter failed (errno = %d)\n",
+		       adapter_name, result);
+	}
+	fe->adapter.priv = adapter_priv;
+	fe->adapter.mfe_shared = mfe_shared;
+	fe->adapter.fe_ioctl_override = fe_ioctl_override;
+
+	return result;
+}
+
+static int vb2_dvb_register_frontend(struct dvb_adapter *adapter,
+	struct vb2_dvb *dvb)
+{
+	int result;
+
+	/* register frontend */
+	result = dvb_register_frontend(adapter, dvb->frontend);
+	if (result < 0) {
+		printk(KERN_WARNING "%s: dvb_register_frontend failed (errno = %d)\n",
+		       dvb->name, result);
+		goto fail_frontend;
+	}
+
+	/* register demux stuff */
+	dvb->demux.dmx.capabilities =
+		DMX_TS_FILTERING | DMX_SECTION_FILTERING |
+		DMX_MEMORY_BASED_FILTERING;
+	dvb->demux.priv       = dvb;
+	dvb->demux.filternum  = 256;
+	dvb->demux.feednum    = 256;
+	dvb->demux.start_feed = vb2_dvb_start_feed;
+	dvb->demux.stop_feed  = vb2_dvb_stop_feed;
+	result = dvb_dmx_init(&dvb->demux);
+	if (result < 0) {
+		printk(KERN_WARNING "%s: dvb_dmx_init failed (errno = %d)\n",
+		       dvb->name, result);
+		goto fail_dmx;
+	}
+
+	dvb->dmxdev.filternum    = 256;
+	dvb->dmxdev.demux        = &dvb->demux.dmx;
+	dvb->dmxdev.capabilities = 0;
+	result = dvb_dmxdev_init(&dvb->dmxdev, adapter);
+
+	if (result < 0) {
+		printk(KERN_WARNING "%s: dvb_dmxdev_init failed (errno = %d)\n",
+		       dvb->name, result);
+		goto fail_dmxdev;
+	}
+
+	dvb->fe_hw.source = DMX_FRONTEND_0;
+	result = dvb->demux.dmx.add_frontend(&dvb->demux.dmx, &dvb->fe_hw);
+	if (result < 0) {
+		printk(KERN_WARNING "%s: add_frontend failed (DMX_FRONTEND_0, errno = %d)\n",
+		       dvb->name, result);
+		goto fail_fe_hw;
+	}
+
+	dvb->fe_mem.source = DMX_MEMORY_FE;
+	result = dvb->demux.dmx.add_frontend(&dvb->demux.dmx, &dvb->fe_mem);
+	if (result < 0) {
+		printk(KERN_WARNING "%s: add_frontend failed (DMX_MEMORY_FE, errno = %d)\n",
+		       dvb->name, result);
+		goto fail_fe_mem;
+	}
+
+	result = dvb->demux.dmx.connect_frontend(&dvb->demux.dmx, &dvb->fe_hw);
+	if (result < 0) {
+		printk(KERN_WARNING "%s: connect_frontend failed (errno = %d)\n",
+		       dvb->name, result);
+		goto fail_fe_conn;
+	}
+
+	/* register network adapter */
+	dvb_net_init(adapter, &dvb->net, &dvb->demux.dmx);
+	if (dvb->net.dvbdev == NULL) {
+		result = -ENOMEM;
+		goto fail_fe_conn;
+	}
+	return 0;
+
+fail_fe_conn:
+	dvb->demux.dmx.remove_frontend(&dvb->demux.dmx, &dvb->fe_mem);
+fail_fe_mem:
+	dvb->demux.dmx.remove_frontend(&dvb->demux.dmx, &dvb->fe_hw);
+fail_fe_hw:
+	dvb_dmxdev_release(&dvb->dmxdev);
+fail_dmxdev:
+	dvb_dmx_release(&dvb->demux);
+fail_dmx:
+	dvb_unregister_frontend(dvb->frontend);
+fail_frontend:
+	dvb_frontend_detach(dvb->frontend);
+	dvb->frontend = NULL;
+
+	return result;
+}
+
+/* ------------------------------------------------------------------ */
+/* Register a single adapter and one or more frontends */
+int vb2_dvb_register_bus(struct vb2_dvb_frontends *f,
+			  struct module *module,
+			  void *adapter_priv,
+			  struct device *device,
+			  short *adapter_nr,
+			  int mfe_shared,
+			  int (*fe_ioctl_override)(struct dvb_frontend *,
+					unsigned int, void *, unsigned int))
+{
+	struct list_head *list, *q;
+	struct vb2_dvb_frontend *fe;
+	int res;
+
+	fe = vb2_dvb_get_frontend(f, 1);
+	if (!fe) {
+		printk(KERN_WARNING "Unable to register the adapter which has no frontends\n");
+		return -EINVAL;
+	}
+
+	/* Bring up the adapter */
+	res = vb2_dvb_register_adapter(f, module, adapter_priv, device,
+		fe->dvb.name, adapter_nr, mfe_shared, fe_ioctl_override);
+	if (res < 0) {
+		printk(KERN_WARNING "vb2_dvb_register_adapter failed (errno = %d)\n", res);
+		return res;
+	}
+
+	/* Attach all of the frontends to the adapter */
+	mutex_lock(&f->lock);
+	list_for_each_safe(list, q, &f->felist) {
+		fe = list_entry(list, struct vb2_dvb_frontend, felist);
+		res = vb2_dvb_register_frontend(&f->adapter, &fe->dvb);
+		if (res < 0) {
+			printk(KERN_WARNING "%s: vb2_dvb_register_frontend failed (errno = %d)\n",
+				fe->dvb.name, res);
+			goto err;
+		}
+	}
+	mutex_unlock(&f->lock);
+	return 0;
+
+err:
+	mutex_unlock(&f->lock);
+	vb2_dvb_unregister_bus(f);
+	return res;
+}
+EXPORT_SYMBOL(vb2_dvb_register_bus);
+
+void vb2_dvb_unregister_bus(struct vb2_dvb_frontends *f)
+{
+	vb2_dvb_dealloc_frontends(f);
+
+	dvb_unregister_adapter(&f->adapter);
+}
+EXPORT_SYMBOL(vb2_dvb_unregister_bus);
+
+struct vb2_dvb_frontend *vb2_dvb_get_frontend(
+	struct vb2_dvb_frontends *f, int id)
+{
+	struct list_head *list, *q;
+	struct vb2_dvb_frontend *fe, *ret = NULL;
+
+	mutex_lock(&f->lock);
+
+	list_for_each_safe(list, q, &f->felist) {
+		fe = list_entry(list, struct vb2_dvb_frontend, felist);
+		if (fe->id == id) {
+			ret = fe;
+			break;
+		}
+	}
+
+	mutex_unlock(&f->lock);
+
+	return ret;
+}
+EXPORT_SYMBOL(vb2_dvb_get_frontend);
+
+int vb2_dvb_find_frontend(struct vb2_dvb_frontends *f,
+	struct dvb_frontend *p)
+{
+	struct list_head *list, *q;
+	struct vb2_dvb_frontend *fe = NULL;
+	int ret = 0;
+
+	mutex_lock(&f->lock);
+
+	list_for_each_safe(list, q, &f->felist) {
+		fe = list_entry(list, struct vb2_dvb_frontend, felist);
+		if (fe->dvb.frontend == p) {
+			ret = fe->id;
+			break;
+		}
+	}
+
+	mutex_unlock(&f->lock);
+
+	return ret;
+}
+EXPORT_SYMBOL(vb2_dvb_find_frontend);
+
+struct vb2_dvb_frontend *vb2_dvb_alloc_frontend(
+	struct vb2_dvb_frontends *f, int id)
+{
+	struct vb2_dvb_frontend *fe;
+
+	fe = kzalloc(sizeof(struct vb2_dvb_frontend), GFP_KERNEL);
+	if (fe == NULL)
+		goto fail_alloc;
+
+	fe->id = id;
+	mutex_init(&fe->dvb.lock);
+	INIT_WORK(&fe->dvb.work, vb2_dvb_work);
+
+	mutex_lock(&f->lock);
+	list_add_tail(&fe->felist, &f->felist);
+	mutex_unlock(&f->lock);
+
+fail_alloc:
+	return fe;
+}
+EXPORT_SYMBOL(vb2_dvb_alloc_frontend);
+
+void vb2_dvb_dealloc_frontends(struct vb2_dvb_frontends *f)
+{
+	struct list_head *list, *q;
+	struct vb2_dvb_frontend *fe;
+
+	mutex_lock(&f->lock);
+	list_for_each_safe(list, q, &f->felist) {
+		fe = list_entry(list, struct vb2_dvb_frontend, felist);
+		if (fe->dvb.net.dvbdev) {
+			dvb_net_release(&fe->dvb.net);
+			fe->dvb.demux.dmx.remove_frontend(&fe->dvb.demux.dmx,
+				&fe->dvb.fe_mem);
+			fe->dvb.demux.dmx.remove_frontend(&fe->dvb.demux.dmx,
+				&fe->dvb.fe_hw);
+			dvb_dmxdev_release(&fe->dvb.dmxdev);
+			dvb_dmx_release(&fe->dvb.demux);
+			dvb_unregister_frontend(fe->dvb.frontend);
+		}
+		if (fe->dvb.frontend)
+			/* always allocated, may have been reset */
+			dvb_frontend_detach(fe->dvb.frontend);
+		if (fe->dvb.dvbq.ops) {
+			/* the driver did vb2_queue_init() on it; releasing
+			 * stops streaming, which may still queue the work */
+			vb2_queue_release(&fe->dvb.dvbq);
+			cancel_work_sync(&fe->dvb.work);
+		}
+		list_del(list); /* remove list entry */
+		kfree(fe);	/* free frontend allocation */
+	}
+	mutex_unlock(&f->lock);
+}
+EXPORT_SYMBOL(vb2_dvb_dealloc_frontends);
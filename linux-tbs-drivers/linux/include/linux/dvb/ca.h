@@ -78,6 +78,12 @@ typedef struct ca_pid {
 	int index;		/* -1 == disable*/
 } ca_pid_t;
 
+/* TS of a slot fed around the CAM instead of through it */
+typedef struct ca_ts_bypass {
+	unsigned int slot;
+	int bypass;		/* 1 == CAM bypassed */
+} ca_ts_bypass_t;
+
 #define CA_RESET          _IO('o', 128)
 #define CA_GET_CAP        _IOR('o', 129, ca_caps_t)
 #define CA_GET_SLOT_INFO  _IOR('o', 130, ca_slot_info_t)
@@ -86,5 +92,7 @@ typedef struct ca_pid {
 #define CA_SEND_MSG       _IOW('o', 133, ca_msg_t)
 #define CA_SET_DESCR      _IOW('o', 134, ca_descr_t)
 #define CA_SET_PID        _IOW('o', 135, ca_pid_t)
+#define CA_GET_TS_BYPASS  _IOWR('o', 136, ca_ts_bypass_t)
+#define CA_SET_TS_BYPASS  _IOW('o', 137, ca_ts_bypass_t)
 
 #endif
@@ -117,6 +117,27 @@ struct dmx_pes_filter_params
 	dmx_output_t   output;
 	dmx_pes_type_t pes_type;
 	__u32          flags;
+#define DMX_PES_ASSEMBLE    8	/* DMX_OUT_TAP only, see dmx_pes_info */
+};
+
+/*
+ * With DMX_PES_ASSEMBLE every read() record is a struct dmx_pes_info
+ * followed by one whole PES packet, header included. A record is never
+ * split, so the filter buffer (DMX_SET_BUFFER_SIZE) has to hold the
+ * largest PES packet of the stream; larger ones are dropped and flagged
+ * as a discontinuity on the next record.
+ */
+struct dmx_pes_info
+{
+	__u32          length;	/* bytes of PES packet following */
+	__u16          pid;
+	__u16          flags;
+#define DMX_PES_PTS_VALID     1
+#define DMX_PES_DTS_VALID     2
+#define DMX_PES_DISCONTINUITY 4	/* data was lost before this packet */
+#define DMX_PES_RANDOM_ACCESS 8	/* random_access_indicator was set */
+	__u64          pts;	/* 90 kHz */
+	__u64          dts;	/* 90 kHz */
 };
 
 typedef struct dmx_caps {
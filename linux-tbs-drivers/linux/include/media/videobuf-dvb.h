@@ -12,11 +12,14 @@ struct videobuf_dvb {
 	char                       *name;
 	struct dvb_frontend        *frontend;
 	struct videobuf_queue      dvbq;
+	/* every buffer holds whole TS packets starting at offset 0 */
+	int                        aligned;
 
 	/* video-buf-dvb state info */
 	struct mutex               lock;
 	struct task_struct         *thread;
 	int                        nfeeds;
+	unsigned long              unaligned;  /* aligned buffers that were not */
 
 	/* videobuf_dvb_(un)register manges this */
 	struct dvb_demux           demux;
@@ -0,0 +1,86 @@
+#include <dvbdev.h>
+#include <dmxdev.h>
+#include <dvb_demux.h>
+#include <dvb_net.h>
+#include <dvb_frontend.h>
+
+#include <linux/workqueue.h>
+#include <media/videobuf2-core.h>
+
+#ifndef _VIDEOBUF2_DVB_H_
+#define	_VIDEOBUF2_DVB_H_
+
+/*
+ * Counterpart of videobuf-dvb for bridges using videobuf2.
+ *
+ * The driver sets up dvbq (type, io_modes including VB2_MMAP, ops, mem_ops,
+ * drv_priv, buf_struct_size) and calls vb2_queue_init() on it before
+ * registering the bus. Any allocator providing a kernel mapping works, so
+ * both videobuf2-dma-contig and videobuf2-dma-sg queues can be used. The
+ * driver completes buffers with vb2_dvb_buffer_done() instead of
+ * vb2_buffer_done(); the demux then runs from a work item that drains every
+ * buffer completed since it last ran.
+ */
+struct vb2_dvb {
+	/* filling that the job of the driver */
+	char                       *name;
+	struct dvb_frontend        *frontend;
+	struct vb2_queue           dvbq;
+	/* every buffer holds whole TS packets starting at offset 0 */
+	int                        aligned;
+	/* buffers to allocate, 0 lets queue_setup decide */
+	unsigned int               nbufs;
+
+	/* vb2-dvb state info */
+	struct mutex               lock;
+	struct work_struct         work;
+	int                        nfeeds;
+	int                        streaming;
+	unsigned long              unaligned;  /* aligned buffers that were not */
+	unsigned long              wakeups;    /* work runs that found data */
+	unsigned long              buffers;    /* buffers fed to the demux */
+	unsigned int               max_batch;  /* most buffers in one run */
+
+	/* vb2_dvb_(un)register manages this */
+	struct dvb_demux           demux;
+	struct dmxdev              dmxdev;
+	struct dmx_frontend        fe_hw;
+	struct dmx_frontend        fe_mem;
+	struct dvb_net             net;
+};
+
+struct vb2_dvb_frontend {
+	struct list_head felist;
+	int id;
+	struct vb2_dvb dvb;
+};
+
+struct vb2_dvb_frontends {
+	struct list_head felist;
+	struct mutex lock;
+	struct dvb_adapter adapter;
+	int active_fe_id; /* Indicates which frontend in the felist is in use */
+	int gate; /* Frontend with gate control 0=!MFE,1=fe0,2=fe1 etc */
+};
+
+int vb2_dvb_register_bus(struct vb2_dvb_frontends *f,
+			 struct module *module,
+			 void *adapter_priv,
+			 struct device *device,
+			 short *adapter_nr,
+			 int mfe_shared,
+			 int (*fe_ioctl_override)(struct dvb_frontend *,
+					unsigned int, void *, unsigned int));
+
+void vb2_dvb_unregister_bus(struct vb2_dvb_frontends *f);
+
+struct vb2_dvb_frontend *vb2_dvb_alloc_frontend(struct vb2_dvb_frontends *f, int id);
+void vb2_dvb_dealloc_frontends(struct vb2_dvb_frontends *f);
+
+struct vb2_dvb_frontend *vb2_dvb_get_frontend(struct vb2_dvb_frontends *f, int id);
+int vb2_dvb_find_frontend(struct vb2_dvb_frontends *f, struct dvb_frontend *p);
+
+/* may be called from interrupt context */
+void vb2_dvb_buffer_done(struct vb2_buffer *vb, enum vb2_buffer_state state);
+
+#endif			/* _VIDEOBUF2_DVB_H_ */
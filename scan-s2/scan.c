@@ -24,7 +24,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/ioctl.h>
-#include <sys/poll.h>
+#include <sys/epoll.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <time.h>
@@ -33,6 +33,7 @@
 #include <assert.h>
 #include <glob.h>
 #include <ctype.h>
+#include <pthread.h>
 
 #include <linux/dvb/version.h>
 #include <linux/dvb/frontend.h>
@@ -114,7 +115,8 @@ enum table_type {
 	NIT
 };
 
-static char demux_devname[80];
+/* per tuner: each tuner of a parallel scan (-M) runs in its own thread */
+static __thread char demux_devname[80];
 
 // Configuration parameters
 int verbosity = 2;
@@ -137,7 +139,7 @@ static fe_spectral_inversion_t spectral_inversion = INVERSION_AUTO;
 static int switch_pos = 0;
 static int uncommitted_switch_pos = 0;
 static int rotor_pos = 0;
-static int curr_rotor_pos = 0;
+static __thread int curr_rotor_pos = 0;
 static char rotor_pos_name[16] = "";
 static char override_orbital_pos[16] = "";
 enum format output_format = OUTPUT_VDR;
@@ -157,11 +159,16 @@ struct section_buf {
 	enum table_id table_id;
 	int table_id_ext;
 	int section_version_number;
+	int last_section_number;
 	uint8_t section_done[32];
 	int sectionfilter_done;
-	time_t timeout;
-	time_t start_time;
-	time_t running_time;
+	int repeated;			/* complete table seen again */
+	int timeout;			/* ms */
+	uint64_t start_time;		/* ms, see now_ms() */
+	uint64_t running_time;		/* ms */
+	uint64_t deadline;		/* see filter_timeout() */
+	uint64_t section0_time;		/* last arrival of section 0 */
+	int heap_index;			/* position in timeout_heap */
 	struct section_buf *next_seg;	/* this is used to handle
 									* segmented tables (like NIT-other)
 									*/
@@ -170,7 +177,24 @@ struct section_buf {
 
 static LIST_HEAD(scanned_transponders);
 static LIST_HEAD(new_transponders);
-static struct transponder *current_tp;
+static __thread struct transponder *current_tp;
+
+/* tuners of a parallel scan, see scan_tuners() */
+#define MAX_TUNERS 16
+
+struct scan_tuner {
+	int adapter;
+	int frontend;
+	int demux;
+	int frontend_fd;
+	pthread_t thread;
+};
+
+/* scan_mutex protects the transponder and service lists */
+static pthread_mutex_t scan_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t scan_cond = PTHREAD_COND_INITIALIZER;
+static int busy_tuners;			/* tuners scanning a transponder */
+static __thread int tuner_busy;
 
 
 static void dump_dvb_parameters (FILE *f, struct transponder *p);
@@ -179,9 +203,63 @@ static void setup_filter (struct section_buf* s, const char *dmx_devname,
 						  enum pid pid, enum table_id tid, int tid_ext,
 						  int run_once, int segmented, int timeout);
 static void add_filter (struct section_buf *s);
+static uint64_t now_ms (void);
+
+/* Section timing observed on the current transponder, per table_id.
+* Used to cut the fixed ETR 211 based timeouts down to what the
+* multiplex actually needs, see filter_timeout().
+*/
+struct table_stat {
+	int samples;
+	unsigned int acquire_ms;	/* longest filter start to complete table */
+	unsigned int repeat_ms;		/* longest repetition interval */
+};
+
+static __thread struct table_stat table_stats[256];
+
+#define ADAPTIVE_TIMEOUT_FACTOR	4
+#define ADAPTIVE_TIMEOUT_MIN	1000	/* ms */
+
+/* longest NIT repetition interval allowed by ETR 211 */
+#define NIT_MAX_INTERVAL	10000	/* ms */
 
 static const char * fe_type2str(fe_type_t t);
 
+/* Transponders are indexed by frequency bucket and polarisation. A bucket
+* is SAME_FREQ_TOLERANCE wide, so a frequency within the tolerance of f is
+* in f's bucket or one of its two neighbours.
+*/
+#define SAME_FREQ_TOLERANCE	2000
+#define TP_HASH_BITS		10
+#define TP_HASH_SIZE		(1 << TP_HASH_BITS)
+#define SERVICE_HASH_SIZE	64
+
+static struct list_head tp_hash[TP_HASH_SIZE];
+static unsigned int tp_seq;
+
+static void init_tp_hash(void)
+{
+	int i;
+
+	for (i = 0; i < TP_HASH_SIZE; i++)
+		INIT_LIST_HEAD(&tp_hash[i]);
+}
+
+static struct list_head *tp_hash_head(uint32_t bucket, enum polarisation pol)
+{
+	uint32_t key = (bucket << 2) | (pol & 3);
+
+	return &tp_hash[(key * 2654435761u) >> (32 - TP_HASH_BITS)];
+}
+
+/* (re)index a transponder, needed whenever its frequency or polarisation changes */
+static void hash_transponder(struct transponder *t)
+{
+	list_del_init(&t->hash);
+	list_add_tail(&t->hash, tp_hash_head(t->frequency / SAME_FREQ_TOLERANCE,
+					     t->polarisation));
+}
+
 /* According to the DVB standards, the combination of network_id and
 * transport_stream_id should be unique, but in real life the satellite
 * operators and broadcasters don't care enough to coordinate
@@ -197,10 +275,16 @@ static struct transponder *alloc_transponder(uint32_t frequency)
 	memset(tp, 0, sizeof(*tp));
 
 	tp->frequency = frequency;
+	tp->seq = tp_seq++;
 
 	INIT_LIST_HEAD(&tp->list);
 	INIT_LIST_HEAD(&tp->services);
+	INIT_LIST_HEAD(&tp->hash);
 	list_add_tail(&tp->list, &new_transponders);
+	hash_transponder(tp);
+
+	/* wake up idle tuners */
+	pthread_cond_broadcast(&scan_cond);
 	return tp;
 }
 
@@ -211,7 +295,7 @@ static int is_same_frequency(uint32_t f1, uint32_t f2)
 		return 1;
 	diff = (f1 > f2) ? (f1 - f2) : (f2 - f1);
 	//FIXME: use symbolrate etc. to estimate bandwidth
-	if (diff < 2000) {
+	if (diff < SAME_FREQ_TOLERANCE) {
 		debug("f1 = %u is same TP as f2 = %u\n", f1, f2);
 		return 1;
 	}
@@ -228,65 +312,71 @@ static int is_same_transponder(struct transponder *t1, struct transponder *t2)
 	}
 }
 
-static struct transponder *find_transponder_by_freq(uint32_t frequency)
-{
-	struct list_head *pos;
-	struct transponder *tp;
-
-	list_for_each(pos, &scanned_transponders) {
-		tp = list_entry(pos, struct transponder, list);
-		if (current_tp_only)
-			return tp;
-
-		if (is_same_frequency(tp->frequency, frequency))
-			return tp;
+/* Like walking the "scanned" and then the "new" list: scanned transponders
+* win, otherwise the one allocated first. pol < 0 matches any polarisation.
+*/
+static struct transponder *lookup_transponder(uint32_t frequency, int pol)
+{
+	struct list_head *pos, *head;
+	struct transponder *tp, *best = NULL;
+	uint32_t bucket = frequency / SAME_FREQ_TOLERANCE;
+	uint32_t b;
+	int p;
+
+	for (b = bucket ? bucket - 1 : 0; b <= bucket + 1; b++) {
+		for (p = 0; p < 4; p++) {
+			if (pol >= 0 && p != pol)
+				continue;
+			head = tp_hash_head(b, p);
+			list_for_each(pos, head) {
+				tp = list_entry(pos, struct transponder, hash);
+				if ((int) tp->polarisation != p ||
+				    tp->frequency / SAME_FREQ_TOLERANCE != b ||
+				    !is_same_frequency(tp->frequency, frequency))
+					continue;
+				if (!best || tp->scan_done > best->scan_done ||
+				    (tp->scan_done == best->scan_done && tp->seq < best->seq))
+					best = tp;
+			}
+		}
 	}
 
-	list_for_each(pos, &new_transponders) {
-		tp = list_entry(pos, struct transponder, list);
+	return best;
+}
 
-		if (is_same_frequency(tp->frequency, frequency))
-			return tp;
-	}
+static struct transponder *find_transponder_by_freq(uint32_t frequency)
+{
+	if (current_tp_only && !list_empty(&scanned_transponders))
+		return list_entry(scanned_transponders.next, struct transponder, list);
 
-	return NULL;
+	return lookup_transponder(frequency, -1);
 }
 
 static struct transponder *find_transponder(uint32_t frequency, enum polarisation pol)
 {
-	struct list_head *pos;
-	struct transponder *tp;
-
-	list_for_each(pos, &scanned_transponders) {
-		tp = list_entry(pos, struct transponder, list);
-		if (current_tp_only)
-			return tp;
+	if (current_tp_only && !list_empty(&scanned_transponders))
+		return list_entry(scanned_transponders.next, struct transponder, list);
 
-		if (is_same_frequency(tp->frequency, frequency) && tp->polarisation == pol)
-			return tp;
-	}
-
-	list_for_each(pos, &new_transponders) {
-		tp = list_entry(pos, struct transponder, list);
-
-		if (is_same_frequency(tp->frequency, frequency) && tp->polarisation == pol)
-			return tp;
-	}
-
-	return NULL;
+	return lookup_transponder(frequency, pol);
 }
 
 static void remove_duplicate_transponder(struct transponder *t)
 {
-	struct list_head *pos;
+	struct list_head *pos, *tmp, *head;
 	struct transponder *tp;
-
-	list_for_each(pos, &new_transponders) {
-		tp = list_entry(pos, struct transponder, list);
-
-		if (is_same_transponder(tp, t) && tp != t) {
-			pos = tp->list.prev;
-			list_del_init(&tp->list);
+	uint32_t bucket = t->frequency / SAME_FREQ_TOLERANCE;
+	uint32_t b;
+
+	for (b = bucket ? bucket - 1 : 0; b <= bucket + 1; b++) {
+		head = tp_hash_head(b, t->polarisation);
+		list_for_each_safe(pos, tmp, head) {
+			tp = list_entry(pos, struct transponder, hash);
+
+			/* only those still on the "new" list */
+			if (tp != t && !tp->scan_done && is_same_transponder(tp, t)) {
+				list_del_init(&tp->list);
+				list_del_init(&tp->hash);
+			}
 		}
 	}
 }
@@ -346,12 +436,26 @@ static void copy_transponder(struct transponder *d, struct transponder *s, int i
 * (the DVB standards say theay should be unique within one
 * network, but in real life...)
 */
+static struct list_head *service_hash_head(struct transponder *tp, int service_id)
+{
+	return &tp->service_hash[service_id & (SERVICE_HASH_SIZE - 1)];
+}
+
 static struct service *alloc_service(struct transponder *tp, int service_id)
 {
 	struct service *s = calloc(1, sizeof(*s));
+	int i;
+
+	if (!tp->service_hash) {
+		tp->service_hash = calloc(SERVICE_HASH_SIZE, sizeof(struct list_head));
+		for (i = 0; i < SERVICE_HASH_SIZE; i++)
+			INIT_LIST_HEAD(&tp->service_hash[i]);
+	}
+
 	INIT_LIST_HEAD(&s->list);
 	s->service_id = service_id;
 	list_add_tail(&s->list, &tp->services);
+	list_add_tail(&s->hash, service_hash_head(tp, service_id));
 	return s;
 }
 
@@ -359,8 +463,12 @@ static struct service *find_service(struct transponder *tp, int service_id)
 {
 	struct list_head *pos;
 	struct service *s;
-	list_for_each(pos, &tp->services) {
-		s = list_entry(pos, struct service, list);
+
+	if (!tp->service_hash)
+		return NULL;
+
+	list_for_each(pos, service_hash_head(tp, service_id)) {
+		s = list_entry(pos, struct service, hash);
 
 		if (s->service_id == service_id)
 			return s;
@@ -1093,6 +1201,7 @@ static void parse_nit (struct section_buf *sb, const unsigned char *buf, int sec
 				if(current_tp->delivery_system == SYS_DVBS || current_tp->delivery_system == SYS_DVBS2) {
 					tn.delivery_system = SYS_DVBS;
 					copy_transponder(t, &tn, TRUE);
+					hash_transponder(t);
 
 					t = alloc_transponder(tn.frequency);
 					tn.delivery_system = SYS_DVBS2;
@@ -1101,11 +1210,13 @@ static void parse_nit (struct section_buf *sb, const unsigned char *buf, int sec
 				else {
 					copy_transponder(t, &tn, TRUE);
 				}
+				hash_transponder(t);
 			}
 		}
 		else {
 			// Trasponder exist, update transponder info, don't override known values
 			copy_transponder(t, &tn, FALSE);
+			hash_transponder(t);
 		}
 
 		streams_loop_len -= (descriptors_loop_len + 6);
@@ -1348,6 +1459,7 @@ static int parse_section(struct section_buf *sb, unsigned char *buf)
 	int section_version_number;
 	int section_number;
 	int last_section_number;
+	struct section_buf *root = sb;
 	int i;
 
 	table_id = getBits(buf, 0, 8);
@@ -1383,6 +1495,7 @@ static int parse_section(struct section_buf *sb, unsigned char *buf)
 			sb->table_id = table_id;
 			sb->table_id_ext = table_id_ext;
 			sb->section_version_number = section_version_number;
+			sb->last_section_number = -1;
 		}
 	}
 
@@ -1398,11 +1511,38 @@ static int parse_section(struct section_buf *sb, unsigned char *buf)
 
 		sb->table_id_ext = table_id_ext;
 		sb->section_version_number = section_version_number;
+		sb->last_section_number = -1;
 		sb->sectionfilter_done = 0;
+		sb->repeated = 0;
 		memset (sb->section_done, 0, sizeof(sb->section_done));
 		sb->next_seg = next_seg;
 	}
 
+	if (section_number > last_section_number) {
+		warning("bad section number %d/%d (PID 0x%04X, table_id 0x%02X)\n",
+			section_number, last_section_number, sb->pid, table_id);
+		return 0;
+	}
+	if (sb->last_section_number != last_section_number) {
+		/* the table grew or shrank: sections beyond the new end are stale */
+		for (i = last_section_number + 1; i < 256; i++)
+			sb->section_done[i / 8] &= ~(1 << (i % 8));
+		sb->last_section_number = last_section_number;
+		sb->sectionfilter_done = 0;
+	}
+
+	if (section_number == 0) {
+		uint64_t now = now_ms();
+
+		if (sb->section0_time && get_bit(sb->section_done, 0)) {
+			struct table_stat *st = &table_stats[table_id];
+
+			if (now - sb->section0_time > st->repeat_ms)
+				st->repeat_ms = now - sb->section0_time;
+		}
+		sb->section0_time = now;
+	}
+
 	buf += 8;			/* past generic table header */
 	section_length -= CRC_LEN;	// Reduce CRC
 	section_length -= 5;		// Reduce common part of the messages up to last_section_number
@@ -1465,12 +1605,22 @@ static int parse_section(struct section_buf *sb, unsigned char *buf)
 		if (i > last_section_number)
 			sb->sectionfilter_done = 1;
 	}
-
-	if (sb->segmented) {
-		/* always wait for timeout; this is because we don't now how
-		* many segments there are
+	else if (sb->sectionfilter_done)
+		sb->repeated = 1;
+
+	if (root->segmented) {
+		/* We don't know how many segments there are. They share one PID
+		* but each may have its own repetition rate, so a segment seen
+		* again says nothing about segments not seen yet. Only after the
+		* longest interval ETR 211 allows, every segment has shown up;
+		* then stop once all of them are complete and have come round.
 		*/
-		return 0;
+		if (now_ms() - root->start_time < NIT_MAX_INTERVAL)
+			return 0;
+		for (sb = root; sb; sb = sb->next_seg)
+			if (!sb->sectionfilter_done || !sb->repeated)
+				return 0;
+		return 1;
 	}
 	else if (sb->sectionfilter_done)
 		return 1;
@@ -1481,7 +1631,7 @@ static int parse_section(struct section_buf *sb, unsigned char *buf)
 static int read_sections (struct section_buf *sb)
 {
 	unsigned char buffer[4096];	// CAT can be up to 4K, the rest are 1K max
-	int section_length, count;
+	int section_length, count, rc;
 
 	if (sb->sectionfilter_done && !sb->segmented)
 		return 1;
@@ -1523,19 +1673,165 @@ static int read_sections (struct section_buf *sb)
 	}
 	debug("\n");
 
-	if (parse_section(sb, buffer) == 1)
+	pthread_mutex_lock(&scan_mutex);
+	rc = parse_section(sb, buffer);
+	pthread_mutex_unlock(&scan_mutex);
+
+	if (rc == 1)
 		return 1;
 
 	return 0;
 }
 
-static LIST_HEAD(running_filters);
-static LIST_HEAD(waiting_filters);
-static int n_running;
-#define MAX_RUNNING 128
-static struct pollfd poll_fds[MAX_RUNNING];
-static struct section_buf* poll_section_bufs[MAX_RUNNING];
+static __thread struct list_head running_filters;
+static __thread struct list_head waiting_filters;
+static __thread int epoll_fd = -1;
+
+/* running filters ordered by deadline, a binary min-heap */
+static __thread struct section_buf **timeout_heap;
+static __thread int heap_len, heap_size;
+
+#define MAX_EVENTS 64	/* per epoll_wait() call, not a limit on filters */
+
+
+static uint64_t now_ms (void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void heap_set (int i, struct section_buf *s)
+{
+	timeout_heap[i] = s;
+	s->heap_index = i;
+}
+
+static void heap_sift_up (int i)
+{
+	struct section_buf *s = timeout_heap[i];
+
+	while (i > 0 && timeout_heap[(i - 1) / 2]->deadline > s->deadline) {
+		heap_set(i, timeout_heap[(i - 1) / 2]);
+		i = (i - 1) / 2;
+	}
+	heap_set(i, s);
+}
+
+static void heap_sift_down (int i)
+{
+	struct section_buf *s = timeout_heap[i];
+	int c;
+
+	while ((c = 2 * i + 1) < heap_len) {
+		if (c + 1 < heap_len &&
+			timeout_heap[c + 1]->deadline < timeout_heap[c]->deadline)
+			c++;
+		if (timeout_heap[c]->deadline >= s->deadline)
+			break;
+		heap_set(i, timeout_heap[c]);
+		i = c;
+	}
+	heap_set(i, s);
+}
+
+static void heap_add (struct section_buf *s)
+{
+	if (heap_len == heap_size) {
+		heap_size = heap_size ? 2 * heap_size : 64;
+		timeout_heap = realloc(timeout_heap, heap_size * sizeof(*timeout_heap));
+		if (!timeout_heap)
+			fatal("out of memory\n");
+	}
+	heap_set(heap_len++, s);
+	heap_sift_up(s->heap_index);
+}
+
+static void heap_del (struct section_buf *s)
+{
+	struct section_buf *last;
+	int i = s->heap_index;
+
+	if (--heap_len == i)
+		return;
+	last = timeout_heap[heap_len];
+	heap_set(i, last);
+	heap_sift_down(i);
+	heap_sift_up(last->heap_index);
+}
+
+
+/* The ETR 211 based timeout is an upper bound. Once some tables of the
+* same kind were complete on this transponder, allow a few times the
+* longest acquisition or repetition time seen so far instead.
+*/
+static int filter_timeout (struct section_buf *s)
+{
+	struct table_stat *st = &table_stats[s->table_id];
+	int t;
+
+	if (long_timeout || s->segmented || !st->samples)
+		return s->timeout;
+
+	t = ADAPTIVE_TIMEOUT_FACTOR *
+		(st->acquire_ms > st->repeat_ms ? st->acquire_ms : st->repeat_ms);
+	if (t < ADAPTIVE_TIMEOUT_MIN)
+		t = ADAPTIVE_TIMEOUT_MIN;
+	if (t > s->timeout)
+		t = s->timeout;
+	return t;
+}
+
+static void table_stat_done (struct section_buf *s)
+{
+	struct table_stat *st = &table_stats[s->table_id];
+	struct list_head *p;
+	struct section_buf *r;
+	uint64_t deadline;
+
+	if (s->segmented)
+		return;
+
+	st->samples++;
+	if (now_ms() - s->start_time > st->acquire_ms)
+		st->acquire_ms = now_ms() - s->start_time;
+
+	/* pull in the deadlines of filters still waiting for this table */
+	list_for_each (p, &running_filters) {
+		r = list_entry (p, struct section_buf, list);
+		if (r == s || r->table_id != s->table_id)
+			continue;
+		deadline = r->start_time + filter_timeout(r);
+		if (deadline < r->deadline) {
+			r->deadline = deadline;
+			heap_sift_up(r->heap_index);
+		}
+	}
+}
+
+static void reset_table_stats (void)
+{
+	memset(table_stats, 0, sizeof(table_stats));
+}
+
+static void init_filters (void)
+{
+	INIT_LIST_HEAD (&running_filters);
+	INIT_LIST_HEAD (&waiting_filters);
+	heap_len = 0;
+	if ((epoll_fd = epoll_create(MAX_EVENTS)) < 0)
+		fatal("epoll_create: %d %m\n", errno);
+}
 
+static void exit_filters (void)
+{
+	close (epoll_fd);
+	epoll_fd = -1;
+	free (timeout_heap);
+	timeout_heap = NULL;
+	heap_len = heap_size = 0;
+}
 
 static void setup_filter (struct section_buf* s, const char *dmx_devname,
 						  enum pid pid, enum table_id tid, int tid_ext,
@@ -1553,51 +1849,24 @@ static void setup_filter (struct section_buf* s, const char *dmx_devname,
 	s->segmented = segmented;
 
 	if (long_timeout) {
-		s->timeout = 5 * timeout;
+		s->timeout = 5 * timeout * 1000;
 	}
 	else {
-		s->timeout = timeout;
+		s->timeout = timeout * 1000;
 	}
 
 	s->table_id_ext = tid_ext;
 	s->section_version_number = -1;
+	s->last_section_number = -1;
 
 	INIT_LIST_HEAD (&s->list);
 }
 
-static void update_poll_fds(void)
-{
-	struct list_head *p;
-	struct section_buf* s;
-	int i;
-
-	memset(poll_section_bufs, 0, sizeof(poll_section_bufs));
-	for (i = 0; i < MAX_RUNNING; i++)
-		poll_fds[i].fd = -1;
-	i = 0;
-	list_for_each (p, &running_filters) {
-		if (i >= MAX_RUNNING)
-			fatal("too many poll_fds\n");
-		s = list_entry (p, struct section_buf, list);
-		if (s->fd == -1)
-			fatal("s->fd == -1 on running_filters\n");
-		verbosedebug("poll fd %d\n", s->fd);
-		poll_fds[i].fd = s->fd;
-		poll_fds[i].events = POLLIN;
-		poll_fds[i].revents = 0;
-		poll_section_bufs[i] = s;
-		i++;
-	}
-	if (i != n_running)
-		fatal("n_running is hosed\n");
-}
-
 static int start_filter (struct section_buf* s)
 {
 	struct dmx_sct_filter_params f;
+	struct epoll_event ev;
 
-	if (n_running >= MAX_RUNNING)
-		goto err0;
 	if ((s->fd = open (s->dmx_devname, O_RDWR | O_NONBLOCK)) < 0)
 		goto err0;
 
@@ -1626,15 +1895,22 @@ static int start_filter (struct section_buf* s)
 		goto err1;
 	}
 
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.ptr = s;
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, s->fd, &ev) == -1) {
+		errorn ("epoll_ctl EPOLL_CTL_ADD failed");
+		goto err1;
+	}
+
 	s->sectionfilter_done = 0;
-	time(&s->start_time);
+	s->start_time = now_ms();
+	s->deadline = s->start_time + filter_timeout(s);
+	heap_add(s);
 
 	list_del_init (&s->list);  /* might be in waiting filter list */
 	list_add (&s->list, &running_filters);
 
-	n_running++;
-	update_poll_fds();
-
 	return 0;
 
 err1:
@@ -1648,14 +1924,13 @@ err0:
 static void stop_filter (struct section_buf *s)
 {
 	verbosedebug("stop filter pid 0x%04X\n", s->pid);
+	epoll_ctl (epoll_fd, EPOLL_CTL_DEL, s->fd, NULL);
 	ioctl (s->fd, DMX_STOP);
 	close (s->fd);
 	s->fd = -1;
 	list_del (&s->list);
-	s->running_time += time(NULL) - s->start_time;
-
-	n_running--;
-	update_poll_fds();
+	heap_del (s);
+	s->running_time += now_ms() - s->start_time;
 }
 
 
@@ -1683,29 +1958,46 @@ static void remove_filter (struct section_buf *s)
 
 static void read_filters (void)
 {
+	struct epoll_event events[MAX_EVENTS];
 	struct section_buf *sb;
-	int i, n, done;
-
-	n = poll(poll_fds, n_running, 1000);
-	if (n == -1)
-		errorn("poll");
-
-	for (i = 0; i < n_running; i++) {
-		sb = poll_section_bufs[i];
-		if (!sb)
-			fatal("poll_section_bufs[%d] is NULL\n", i);
-		if (poll_fds[i].revents)
-			done = read_sections (sb) == 1;
+	uint64_t now;
+	int i, n, timeout = -1;
+
+	if (heap_len) {
+		now = now_ms();
+		if (timeout_heap[0]->deadline > now)
+			timeout = timeout_heap[0]->deadline - now;
 		else
-			done = 0; /* timeout */
-		if (done || time(NULL) > sb->start_time + sb->timeout) {
-			if (sb->run_once) {
-				if (done)
-					verbosedebug("filter done pid 0x%04X\n", sb->pid);
-				else
-					warning("filter timeout pid 0x%04X\n", sb->pid);
-				remove_filter (sb);
-			}
+			timeout = 0;
+	}
+
+	n = epoll_wait(epoll_fd, events, MAX_EVENTS, timeout);
+	if (n == -1) {
+		if (errno != EINTR)
+			errorn("epoll_wait");
+		n = 0;
+	}
+
+	for (i = 0; i < n; i++) {
+		sb = events[i].data.ptr;
+		if (sb->fd == -1)
+			continue; /* removed while handling this batch */
+		if (read_sections (sb) == 1 && sb->run_once) {
+			verbosedebug("filter done pid 0x%04X\n", sb->pid);
+			table_stat_done (sb);
+			remove_filter (sb);
+		}
+	}
+
+	now = now_ms();
+	while (heap_len && timeout_heap[0]->deadline <= now) {
+		sb = timeout_heap[0];
+		if (sb->run_once) {
+			warning("filter timeout pid 0x%04X\n", sb->pid);
+			remove_filter (sb);
+		} else {
+			sb->deadline = now + sb->timeout;
+			heap_sift_down (0);
 		}
 	}
 }
@@ -1874,7 +2166,9 @@ static int __tune_to_transponder (int frontend_fd, struct transponder *t)
 			t->last_tuning_failed = 0;
 
 			/* Remove duplicate entries for the same frequency that were created for other delivery systems */
+			pthread_mutex_lock(&scan_mutex);
 			remove_duplicate_transponder(t);
+			pthread_mutex_unlock(&scan_mutex);
 
 
 			struct dtv_property p[] = {
@@ -1896,11 +2190,13 @@ static int __tune_to_transponder (int frontend_fd, struct transponder *t)
 				return;
 			}
 
+			pthread_mutex_lock(&scan_mutex);
 			t->delivery_system = p[0].u.data;
 			t->modulation = p[1].u.data;
 			t->fec = p[2].u.data;
 			t->inversion = p[3].u.data;
 			t->rolloff = p[4].u.data;
+			pthread_mutex_unlock(&scan_mutex);
 
 			return 0;
 		}
@@ -1915,11 +2211,6 @@ static int __tune_to_transponder (int frontend_fd, struct transponder *t)
 
 static int tune_to_transponder (int frontend_fd, struct transponder *t)
 {
-	/* move TP from "new" to "scanned" list */
-	list_del_init(&t->list);
-	list_add_tail(&t->list, &scanned_transponders);
-	t->scan_done = 1;
-
 	switch(t->delivery_system) 
 	{
 	case SYS_DVBS:
@@ -1962,15 +2253,42 @@ static int tune_to_transponder (int frontend_fd, struct transponder *t)
 	return __tune_to_transponder (frontend_fd, t);
 }
 
+/* Take the next transponder off the "new" list and move it to the "scanned"
+* list. While other tuners are still busy they may find more transponders,
+* so wait for them before reporting the list as done.
+*/
+static struct transponder *get_next_transponder (void)
+{
+	struct transponder *t = NULL;
+
+	pthread_mutex_lock(&scan_mutex);
+	if (tuner_busy) {
+		tuner_busy = 0;
+		busy_tuners--;
+		pthread_cond_broadcast(&scan_cond);
+	}
+	while (list_empty(&new_transponders) && busy_tuners > 0)
+		pthread_cond_wait(&scan_cond, &scan_mutex);
+	if (!list_empty(&new_transponders)) {
+		t = list_entry(new_transponders.next, struct transponder, list);
+		list_del_init(&t->list);
+		list_add_tail(&t->list, &scanned_transponders);
+		t->scan_done = 1;
+		tuner_busy = 1;
+		busy_tuners++;
+	}
+	pthread_mutex_unlock(&scan_mutex);
+
+	return t;
+}
+
 static int tune_to_next_transponder (int frontend_fd)
 {
-	struct list_head *pos, *tmp;
 	struct transponder *t, *to;
 	uint32_t freq;
 	int rc;
 
-	list_for_each_safe(pos, tmp, &new_transponders) {
-		t = list_entry (pos, struct transponder, list);
+	while ((t = get_next_transponder()) != NULL) {
 retry:
 
 		rc = tune_to_transponder(frontend_fd, t);
@@ -1983,28 +2301,38 @@ retry:
 			return -2;
 		}
 next:
+		/* parse_nit() may replace other_f of a transponder being tuned */
+		pthread_mutex_lock(&scan_mutex);
 		if (t->other_frequency_flag && t->other_f && t->n_other_f) {
 			/* check if the alternate freqeuncy is really new to us */
 			freq = t->other_f[t->n_other_f - 1];
 			t->n_other_f--;
 
-			if (find_transponder_by_freq(freq))
+			if (find_transponder_by_freq(freq)) {
+				pthread_mutex_unlock(&scan_mutex);
 				goto next;
+			}
 
 			/* remember tuning to the old frequency failed */
 			to = calloc(1, sizeof(*to));
 			to->frequency = t->frequency;
 			to->wrong_frequency = 1;
+			to->seq = tp_seq++;
 			INIT_LIST_HEAD(&to->list);
 			INIT_LIST_HEAD(&to->services);
+			INIT_LIST_HEAD(&to->hash);
 			list_add_tail(&to->list, &scanned_transponders);
 			copy_transponder(to, t, FALSE);
+			hash_transponder(to);
 
 			t->frequency = freq;
-			info("retrying with f=%d\n", t->frequency);
+			hash_transponder(t);
+			pthread_mutex_unlock(&scan_mutex);
+			info("retrying with f=%d\n", freq);
 
 			goto retry;
 		}
+		pthread_mutex_unlock(&scan_mutex);
 	}
 	return -1;
 }
@@ -2251,7 +2579,7 @@ float rotor_angle(int nn) {
 	return -999;
 }
 
-static int tune_initial (int frontend_fd, const char *initial)
+static int read_initial (const char *initial)
 {
 	FILE *inif;
 	unsigned int f, sr;
@@ -2377,6 +2705,7 @@ static int tune_initial (int frontend_fd, const char *initial)
 							}
 							t->inversion = spectral_inversion;
 							t->symbol_rate = sr;
+							hash_transponder(t);
 
 							info("initial transponder DVB-S%s %u %c %d %s %s %s\n",
 								t->delivery_system==SYS_DVBS?" ":"2",
@@ -2482,6 +2811,14 @@ static int tune_initial (int frontend_fd, const char *initial)
 
 	fclose(inif);
 
+	return 0;
+}
+
+static int tune_initial (int frontend_fd, const char *initial)
+{
+	if (read_initial(initial) < 0)
+		return -1;
+
 	return tune_to_next_transponder(frontend_fd);
 }
 
@@ -2563,6 +2900,9 @@ static void scan_tp(int frontend_fd)
 		return;
 	}
 
+	/* section timing is learned per transponder */
+	reset_table_stats();
+
 	switch(p[0].u.data) 
 	{
 	case SYS_DVBS:
@@ -2600,6 +2940,78 @@ static void scan_network (int frontend_fd, const char *initial)
 	} while (rc == 0);
 }
 
+static void *scan_tuner_thread (void *arg)
+{
+	struct scan_tuner *tuner = arg;
+	int rc;
+
+	init_filters();
+	snprintf (demux_devname, sizeof(demux_devname),
+		"/dev/dvb/adapter%i/demux%i", tuner->adapter, tuner->demux);
+
+	do {
+		do {
+			rc = tune_to_next_transponder(tuner->frontend_fd);
+		} while(rc == -2);
+		if (rc == 0)
+			scan_tp(tuner->frontend_fd);
+	} while (rc == 0);
+
+	exit_filters();
+
+	return NULL;
+}
+
+/* Scan the network with several tuners at once: every tuner takes the
+* next transponder from the "new" list, so NIT results found by one tuner
+* are picked up by whichever tuner is idle.
+*/
+static void scan_tuners (struct scan_tuner *tuners, int n_tuners, const char *initial)
+{
+	int i, started = 0;
+
+	if (read_initial (initial) < 0) {
+		error("initial tuning failed\n");
+		return;
+	}
+
+	for (i = 0; i < n_tuners; i++) {
+		if (pthread_create(&tuners[i].thread, NULL, scan_tuner_thread, &tuners[i])) {
+			errorn("pthread_create");
+			tuners[i].thread = 0;
+			continue;
+		}
+		started++;
+	}
+	if (!started)
+		return;
+
+	for (i = 0; i < n_tuners; i++)
+		if (tuners[i].thread)
+			pthread_join(tuners[i].thread, NULL);
+}
+
+static int parse_tuners (const char *arg, struct scan_tuner *tuners)
+{
+	int n = 0;
+
+	while (*arg) {
+		if (n == MAX_TUNERS)
+			return -1;
+		memset(&tuners[n], 0, sizeof(tuners[n]));
+		if (sscanf(arg, "%d:%d:%d", &tuners[n].adapter,
+			&tuners[n].frontend, &tuners[n].demux) < 1)
+			return -1;
+		n++;
+		arg = strchr(arg, ',');
+		if (!arg)
+			break;
+		arg++;
+	}
+
+	return n;
+}
+
 static int sat_number (struct transponder *t)
 {
 	(void) t;
@@ -2740,6 +3152,9 @@ static const char *usage = "\n"
 "	-a N	use DVB /dev/dvb/adapterN/\n"
 "	-f N	use DVB /dev/dvb/adapter?/frontendN\n"
 "	-d N	use DVB /dev/dvb/adapter?/demuxN\n"
+"	-M a[:f[:d]][,...]\n"
+"		scan with several tuners in parallel, each given as\n"
+"		adapter:frontend:demux (frontend and demux default to 0)\n"
 "	-s N	use DiSEqC switch position N (DVB-S only)\n"
 "	-S N    use DiSEqC uncommitted switch position N (DVB-S only)\n"
 "	-r sat  move DiSEqC rotor to satellite location, e.g. '13.0E' or '1.0W'\n"
@@ -2821,6 +3236,8 @@ int main (int argc, char **argv)
 	int adapter = 0, frontend = 0, demux = 0;
 	int opt, i;
 	int frontend_fd;
+	struct scan_tuner tuners[MAX_TUNERS];
+	int n_tuners = 0;
 	int fe_open_mode;
 	const char *initial = NULL;
 
@@ -2833,7 +3250,7 @@ int main (int argc, char **argv)
 
 	/* start with default lnb type */
 	lnb_type = *lnb_enum(0);
-	while ((opt = getopt(argc, argv, "5cnXpa:f:d:O:k:I:S:s:r:R:o:D:x:t:i:l:vquPA:U")) != -1) {
+	while ((opt = getopt(argc, argv, "5cnXpa:f:d:M:O:k:I:S:s:r:R:o:D:x:t:i:l:vquPA:U")) != -1) {
 		switch (opt) 
 		{
 		case 'a':
@@ -2862,6 +3279,14 @@ int main (int argc, char **argv)
 			frontend = strtoul(optarg, NULL, 0);
 			break;
 
+		case 'M':
+			n_tuners = parse_tuners(optarg, tuners);
+			if (n_tuners <= 0) {
+				bad_usage(argv[0], 0);
+				return -1;
+			}
+			break;
+
 		case 'k':
 			skip_count = strtoul(optarg, NULL, 0);
 			break;
@@ -2976,11 +3401,13 @@ int main (int argc, char **argv)
 	if (optind < argc)
 		initial = argv[optind];
 	if ((!initial && !current_tp_only) || (initial && current_tp_only) ||
-		(spectral_inversion > 2)) {
+		(current_tp_only && n_tuners) || (spectral_inversion > 2)) {
 			bad_usage(argv[0], 0);
 			return -1;
 	}
 
+	init_tp_hash();
+
 	lnb_type.low_val *= 1000;	/* convert to kiloherz */
 	lnb_type.high_val *= 1000;	/* convert to kiloherz */
 	lnb_type.switch_val *= 1000;	/* convert to kiloherz */
@@ -3006,6 +3433,29 @@ int main (int argc, char **argv)
 	if (initial)
 		info("scanning %s\n", initial);
 
+	signal(SIGINT, handle_sigint);
+
+	if (n_tuners) {
+		for (i = 0; i < n_tuners; i++) {
+			snprintf (frontend_devname, sizeof(frontend_devname),
+				"/dev/dvb/adapter%i/frontend%i",
+				tuners[i].adapter, tuners[i].frontend);
+			info("using '%s' and '/dev/dvb/adapter%i/demux%i'\n",
+				frontend_devname, tuners[i].adapter, tuners[i].demux);
+			if ((tuners[i].frontend_fd = open (frontend_devname, O_RDWR | O_NONBLOCK)) < 0)
+				fatal("failed to open '%s': %d %m\n", frontend_devname, errno);
+		}
+
+		scan_tuners (tuners, n_tuners, initial);
+
+		for (i = 0; i < n_tuners; i++)
+			close (tuners[i].frontend_fd);
+
+		dump_lists ();
+
+		return 0;
+	}
+
 	snprintf (frontend_devname, sizeof(frontend_devname),
 		"/dev/dvb/adapter%i/frontend%i", adapter, frontend);
 
@@ -3013,15 +3463,12 @@ int main (int argc, char **argv)
 		"/dev/dvb/adapter%i/demux%i", adapter, demux);
 	info("using '%s' and '%s'\n", frontend_devname, demux_devname);
 
-	for (i = 0; i < MAX_RUNNING; i++)
-		poll_fds[i].fd = -1;
+	init_filters();
 
 	fe_open_mode = current_tp_only ? O_RDONLY : O_RDWR;
 	if ((frontend_fd = open (frontend_devname, fe_open_mode | O_NONBLOCK)) < 0)
 		fatal("failed to open '%s': %d %m\n", frontend_devname, errno);
 
-	signal(SIGINT, handle_sigint);
-
 	if (current_tp_only) {
 		struct dtv_property p[] = {
 			{ .cmd = DTV_FREQUENCY },
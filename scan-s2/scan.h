@@ -58,6 +58,7 @@ enum polarisation {
 
 typedef struct service {
 	struct list_head list;
+	struct list_head hash;		/* transponder's service_hash */
 	int service_id;
 	char *provider_name;
 	char *service_name;
@@ -82,6 +83,9 @@ typedef struct service {
 typedef struct transponder {
 	struct list_head list;
 	struct list_head services;
+	struct list_head hash;		/* frequency/polarisation index */
+	struct list_head *service_hash;	/* service_id index */
+	unsigned int seq;		/* allocation order */
 	int network_id;
 	int original_network_id;
 	int transport_stream_id;